@@ -0,0 +1,15 @@
+#include "aot.h"
+
+const AotProgram *aot_program_for_rom(const u8 *rom, u32 size) {
+    if (!rom || aot_program.count == 0 || size != aot_program.rom_size) {
+        return NULL;
+    }
+    
+    u64 hash = 0xCBF29CE484222325ULL;
+    for (u32 i = 0; i < size; i++) {
+        hash ^= rom[i];
+        hash *= 0x100000001B3ULL;
+    }
+    
+    return (hash == aot_program.rom_hash) ? &aot_program : NULL;
+}
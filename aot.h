@@ -0,0 +1,128 @@
+#ifndef AOT_H
+#define AOT_H
+
+#include "types.h"
+#include "cpu_core.h"
+
+// Ahead-of-time translated Thumb code
+//
+// aot_gen (built when EMERALD_AOT_ROM is set in CMake) walks the Thumb
+// functions of a ROM and writes each basic block out as a C function with
+// the same boundaries and results as the interpreter's block cache. The
+// generated file defines aot_program; without it, aot_stub.c provides an
+// empty one and everything runs in the interpreter/JIT as before.
+
+typedef u32 (*AotBlockFn)(ARM7TDMI *cpu, Memory *mem);
+
+typedef struct AotBlock {
+    u32 pc;                  // Address of the first instruction
+    AotBlockFn run;          // Returns cycles, leaves R15 like cpu_run_block
+} AotBlock;
+
+typedef struct AotProgram {
+    u64 rom_hash;            // FNV-1a of the ROM the blocks were built from
+    u32 rom_size;
+    const AotBlock *blocks;
+    u32 count;
+    const u32 *index;        // Open-addressed: block number + 1, 0 = empty
+    u32 index_mask;
+} AotProgram;
+
+extern const AotProgram aot_program;
+
+// Translated code for this ROM, or NULL if none was built or it was built
+// from a different ROM
+const AotProgram *aot_program_for_rom(const u8 *rom, u32 size);
+
+static inline AotBlockFn aot_lookup(const AotProgram *prog, u32 pc) {
+    u32 i = (pc >> 1) & prog->index_mask;
+    u32 slot;
+    while ((slot = prog->index[i]) != 0) {
+        if (prog->blocks[slot - 1].pc == pc) return prog->blocks[slot - 1].run;
+        i = (i + 1) & prog->index_mask;
+    }
+    return NULL;
+}
+
+// Flag updates used by generated code (must match cpu_core.c): record the
+// operation, cpu_sync_flags() computes N/Z/C/V when they are read
+static inline void aot_flags_logical(ARM7TDMI *cpu, u32 result) {
+    cpu->flag_op |= FLAGS_NZ;  // C/V stay as they are
+    cpu->flag_result = result;
+}
+
+static inline void aot_flags_add(ARM7TDMI *cpu, u32 a, u32 b, u32 result) {
+    cpu->flag_op = FLAGS_NZ | FLAGS_ADD;
+    cpu->flag_result = result;
+    cpu->flag_a = a;
+    cpu->flag_b = b;
+    cpu->flag_cv = result;
+}
+
+static inline void aot_flags_sub(ARM7TDMI *cpu, u32 a, u32 b, u32 result) {
+    cpu->flag_op = FLAGS_NZ | FLAGS_SUB;
+    cpu->flag_result = result;
+    cpu->flag_a = a;
+    cpu->flag_b = b;
+    cpu->flag_cv = result;
+}
+
+static inline u32 aot_carry(ARM7TDMI *cpu) {
+    cpu_sync_flags(cpu);
+    return (cpu->cpsr & FLAG_C) ? 1 : 0;
+}
+
+static inline bool aot_condition(ARM7TDMI *cpu, u32 cond) {
+    // Same shortcuts as check_condition() for a pending compare
+    if (cpu->flag_op == (FLAGS_NZ | FLAGS_SUB) && cpu->flag_result == cpu->flag_cv &&
+        cpu->flag_cv == cpu->flag_a - cpu->flag_b) {
+        u32 a = cpu->flag_a;
+        u32 b = cpu->flag_b;
+        switch (cond) {
+            case 0x0: return a == b;
+            case 0x1: return a != b;
+            case 0x2: return a >= b;
+            case 0x3: return a < b;
+            case 0x8: return a > b;
+            case 0x9: return a <= b;
+            case 0xA: return (s32)a >= (s32)b;
+            case 0xB: return (s32)a < (s32)b;
+            case 0xC: return (s32)a > (s32)b;
+            case 0xD: return (s32)a <= (s32)b;
+        }
+    } else if (cpu->flag_op & FLAGS_NZ) {
+        u32 result = cpu->flag_result;
+        switch (cond) {
+            case 0x0: return result == 0;
+            case 0x1: return result != 0;
+            case 0x4: return (s32)result < 0;
+            case 0x5: return (s32)result >= 0;
+        }
+    }
+    
+    cpu_sync_flags(cpu);
+    bool n = cpu->cpsr & FLAG_N;
+    bool z = cpu->cpsr & FLAG_Z;
+    bool c = cpu->cpsr & FLAG_C;
+    bool v = cpu->cpsr & FLAG_V;
+    
+    switch (cond) {
+        case 0x0: return z;
+        case 0x1: return !z;
+        case 0x2: return c;
+        case 0x3: return !c;
+        case 0x4: return n;
+        case 0x5: return !n;
+        case 0x6: return v;
+        case 0x7: return !v;
+        case 0x8: return c && !z;
+        case 0x9: return !c || z;
+        case 0xA: return n == v;
+        case 0xB: return n != v;
+        case 0xC: return !z && (n == v);
+        case 0xD: return z || (n != v);
+    }
+    return false;
+}
+
+#endif // AOT_H
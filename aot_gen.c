@@ -0,0 +1,385 @@
+// aot_gen - ahead-of-time translator for Thumb code in a GBA ROM
+//
+// Usage: aot_gen <rom.gba> <out_prefix> [symbols.txt]
+//
+// Writes <out_prefix>.c (lookup tables) and <out_prefix>_0.c .. _7.c.
+//
+// Function entries are the targets of every BL in the ROM plus, if given,
+// ROM addresses from a symbol file (one "<hex address> ..." per line, e.g.
+// `nm pokeemerald.elf`). From each entry, the blocks reachable through
+// branches, call returns and fallthrough are written out as C functions
+// for aot.h. Block boundaries and results must match cpu_run_block exactly.
+
+#include "types.h"
+#include "thumb_block.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AOT_MAX_INSTRS          32    // Same as BLOCK_MAX_INSTRS
+#define AOT_MAX_BLOCKS_PER_FUNC 256   // Stop walking runaway "functions" in data
+#define AOT_SHARDS              8     // Generated files besides the table
+#define ROM_BASE                0x08000000
+#define AOT_FIRST_PC            0x08000100
+
+static u8 *rom;
+static u32 rom_size;
+static u8 *visited;          // One bit per halfword: block already queued
+static u32 *blocks;
+static u32 block_count, block_capacity;
+
+static u16 rom_read16(u32 addr) {
+    u32 offset = addr - ROM_BASE;
+    return (u16)(rom[offset] | (rom[offset + 1] << 8));
+}
+
+static bool in_rom(u32 addr) {
+    return addr >= ROM_BASE && addr + 1 < ROM_BASE + rom_size && !(addr & 1);
+}
+
+static bool queue_block(u32 pc, u32 *queue, u32 *queued) {
+    // Like the JIT, skip the header: 0x080000C4-0x080000C9 read as GPIO
+    if (pc < AOT_FIRST_PC || !in_rom(pc)) return false;
+    u32 bit = (pc - ROM_BASE) >> 1;
+    if (visited[bit >> 3] & (1 << (bit & 7))) return false;
+    if (*queued == AOT_MAX_BLOCKS_PER_FUNC) return false;
+    visited[bit >> 3] |= 1 << (bit & 7);
+    queue[(*queued)++] = pc;
+    return true;
+}
+
+// Walk the blocks of one function starting at entry; false if already seen
+static bool walk_function(u32 entry) {
+    u32 queue[AOT_MAX_BLOCKS_PER_FUNC];
+    u32 queued = 0;
+    if (!queue_block(entry, queue, &queued)) return false;
+    
+    for (u32 q = 0; q < queued; q++) {
+        u32 pc = queue[q];
+        u32 addr = pc;
+        u32 n;
+        for (n = 0; n < AOT_MAX_INSTRS && in_rom(addr); n++, addr += 2) {
+            if (thumb_ends_block(rom_read16(addr))) break;
+        }
+        // Blocks running off the end of the ROM are left to the interpreter
+        if (n < AOT_MAX_INSTRS && !in_rom(addr)) continue;
+        
+        if (block_count == block_capacity) {
+            block_capacity = block_capacity ? block_capacity * 2 : 4096;
+            blocks = (u32*)realloc(blocks, block_capacity * sizeof(u32));
+            if (!blocks) {
+                fprintf(stderr, "aot_gen: out of memory\n");
+                exit(1);
+            }
+        }
+        blocks[block_count++] = pc;
+        
+        if (n < AOT_MAX_INSTRS) {
+            u16 op = rom_read16(addr);
+            
+            if ((op >> 12) == 0xD && ((op >> 8) & 0xF) < 0xE) {
+                s32 offset = (s32)(s8)(op & 0xFF) * 2;
+                queue_block(addr + 2, queue, &queued);
+                queue_block(((addr + 4 + offset) & 0xFFFFFFFE), queue, &queued);
+            } else if ((op >> 11) == 0x1C) {
+                s32 offset = (s32)((u32)(op & 0x7FF) << 21) >> 20;
+                queue_block(((addr + 6 + offset) & 0xFFFFFFFE) - 4, queue, &queued);
+            } else if ((op >> 11) == 0x1E) {
+                queue_block(addr + 2, queue, &queued);  // BL suffix (a block of its own)
+                queue_block(addr + 4, queue, &queued);  // Return from BL
+            } else if ((op >> 8) == 0xDF) {
+                queue_block(addr + 2, queue, &queued);  // Return from SWI
+            }
+        } else {
+            queue_block(addr, queue, &queued);
+        }
+    }
+    return true;
+}
+
+// Statement for one instruction that needs no memory access, or false if
+// it has to go through the interpreter handler
+static bool gen_native(FILE *out, u16 op, u32 r15, u32 *cycles) {
+    u32 rd = op & 0x7;
+    u32 rs = (op >> 3) & 0x7;
+    u32 rn = (op >> 6) & 0x7;
+    
+    switch (op >> 11) {
+        case 0x00: case 0x01: case 0x02: {  // Shift by immediate
+            u32 offset = (op >> 6) & 0x1F;
+            if ((op >> 11) == 0) {
+                fprintf(out, "    r = cpu->r[%u] << %u;\n", rs, offset);
+            } else if ((op >> 11) == 1) {
+                if (offset) fprintf(out, "    r = cpu->r[%u] >> %u;\n", rs, offset);
+                else fprintf(out, "    r = 0;\n");
+            } else {
+                fprintf(out, "    r = (u32)((s32)cpu->r[%u] >> %u);\n", rs, offset ? offset : 31);
+            }
+            fprintf(out, "    cpu->r[%u] = r; aot_flags_logical(cpu, r);\n", rd);
+            break;
+        }
+        case 0x03: {  // Add/subtract register or 3-bit immediate
+            bool sub = op & (1 << 9);
+            fprintf(out, "    a = cpu->r[%u]; ", rs);
+            if (op & (1 << 10)) fprintf(out, "b = %u; ", rn);
+            else fprintf(out, "b = cpu->r[%u]; ", rn);
+            fprintf(out, "r = a %c b; cpu->r[%u] = r; aot_flags_%s(cpu, a, b, r);\n",
+                    sub ? '-' : '+', rd, sub ? "sub" : "add");
+            break;
+        }
+        case 0x04:  // MOV rd, #imm
+            fprintf(out, "    cpu->r[%u] = %uu; aot_flags_logical(cpu, %uu);\n", (op >> 8) & 0x7, op & 0xFF, op & 0xFF);
+            break;
+        case 0x05: case 0x06: case 0x07: {  // CMP/ADD/SUB rd, #imm
+            u32 rd8 = (op >> 8) & 0x7;
+            bool sub = (op >> 11) != 0x06;
+            fprintf(out, "    a = cpu->r[%u]; b = %uu; r = a %c b; ", rd8, op & 0xFF, sub ? '-' : '+');
+            if ((op >> 11) != 0x05) fprintf(out, "cpu->r[%u] = r; ", rd8);
+            fprintf(out, "aot_flags_%s(cpu, a, b, r);\n", sub ? "sub" : "add");
+            break;
+        }
+        case 0x08:
+            if ((op >> 10) == 0x10) {
+                static const char *logical[16] = {
+                    "&", "^", NULL, NULL, NULL, NULL, NULL, NULL,
+                    "&", NULL, NULL, NULL, "|", "*", "& ~", NULL
+                };
+                u32 alu = (op >> 6) & 0xF;
+                if (logical[alu]) {  // AND/EOR/TST/ORR/MUL/BIC
+                    fprintf(out, "    r = cpu->r[%u] %s cpu->r[%u]; ", rd, logical[alu], rs);
+                    if (alu != 0x8) fprintf(out, "cpu->r[%u] = r; ", rd);
+                    fprintf(out, "aot_flags_logical(cpu, r);\n");
+                    if (alu == 0xD) *cycles += 1;
+                } else if (alu == 0x5 || alu == 0x6) {  // ADC/SBC
+                    fprintf(out, "    a = cpu->r[%u]; b = cpu->r[%u]; ", rd, rs);
+                    if (alu == 0x5) {
+                        fprintf(out, "r = a + b + aot_carry(cpu); cpu->r[%u] = r; aot_flags_add(cpu, a, b, r);\n", rd);
+                    } else {
+                        fprintf(out, "r = a - b - (1 - aot_carry(cpu)); cpu->r[%u] = r; aot_flags_sub(cpu, a, b, r);\n", rd);
+                    }
+                } else if (alu == 0x9) {  // NEG
+                    fprintf(out, "    b = cpu->r[%u]; r = 0 - b; cpu->r[%u] = r; aot_flags_sub(cpu, 0, b, r);\n", rs, rd);
+                } else if (alu == 0xA || alu == 0xB) {  // CMP/CMN
+                    fprintf(out, "    a = cpu->r[%u]; b = cpu->r[%u]; r = a %c b; aot_flags_%s(cpu, a, b, r);\n",
+                            rd, rs, alu == 0xA ? '-' : '+', alu == 0xA ? "sub" : "add");
+                } else if (alu == 0xF) {  // MVN
+                    fprintf(out, "    r = ~cpu->r[%u]; cpu->r[%u] = r; aot_flags_logical(cpu, r);\n", rs, rd);
+                } else {
+                    return false;  // Shifts by register
+                }
+            } else {
+                // Hi register ADD/CMP/MOV that do not write PC
+                u32 hs = rs | ((op >> 3) & 0x8);
+                u32 hd = rd | ((op >> 4) & 0x8);
+                char src[32], dst[32];
+                if (hs == 15) snprintf(src, sizeof(src), "0x%08Xu", r15);
+                else snprintf(src, sizeof(src), "cpu->r[%u]", hs);
+                if (hd == 15) snprintf(dst, sizeof(dst), "0x%08Xu", r15);
+                else snprintf(dst, sizeof(dst), "cpu->r[%u]", hd);
+                
+                switch ((op >> 8) & 0x3) {
+                    case 0: fprintf(out, "    cpu->r[%u] = %s + %s;\n", hd, dst, src); break;
+                    case 1: fprintf(out, "    a = %s; b = %s; aot_flags_sub(cpu, a, b, a - b);\n", dst, src); break;
+                    case 2: fprintf(out, "    cpu->r[%u] = %s;\n", hd, src); break;
+                    default: return false;
+                }
+            }
+            break;
+        case 0x14:  // ADD rd, PC, #imm
+            fprintf(out, "    cpu->r[%u] = 0x%08Xu;\n", (op >> 8) & 0x7, ((r15 - 2) & ~3u) + (op & 0xFF) * 4);
+            break;
+        case 0x15:  // ADD rd, SP, #imm
+            fprintf(out, "    cpu->r[%u] = cpu->r[13] + %uu;\n", (op >> 8) & 0x7, (op & 0xFF) * 4);
+            break;
+        case 0x16:  // ADD/SUB SP, #imm
+            if ((op & 0xFF00) != 0xB000) return false;
+            fprintf(out, "    cpu->r[13] %c= %uu;\n", (op & (1 << 7)) ? '-' : '+', (op & 0x7F) * 4);
+            break;
+        default:
+            return false;
+    }
+    *cycles += 1;
+    return true;
+}
+
+// "R15 = r15; <lead> [pending +] handler(op)"
+static void gen_handler_call(FILE *out, const char *lead, u32 r15, u32 pending, u16 op) {
+    fprintf(out, "    cpu->r[15] = 0x%08Xu; %s", r15, lead);
+    if (pending) fprintf(out, "%u + ", pending);
+    fprintf(out, "cpu_thumb_handler(0x%04X)(cpu, mem, 0x%04X);\n", op, op);
+}
+
+static void gen_block(FILE *out, u32 pc) {
+    fprintf(out, "u32 aot_%08X(ARM7TDMI *cpu, Memory *mem) {\n", pc);
+    fprintf(out, "    u32 cycles = 0, a, b, r;\n");
+    fprintf(out, "    (void)mem; (void)a; (void)b; (void)r;\n");
+    
+    u32 addr = pc;
+    u32 pending = 0;  // Cycles of inline instructions not yet added
+    for (u32 n = 0; n < AOT_MAX_INSTRS && in_rom(addr); n++, addr += 2) {
+        u16 op = rom_read16(addr);
+        u32 r15 = addr + 6;  // R15 while this instruction executes
+        
+        if (thumb_ends_block(op)) {
+            if ((op >> 12) == 0xD && ((op >> 8) & 0xF) < 0xE) {
+                s32 offset = (s32)(s8)(op & 0xFF) * 2;
+                u32 taken = (((r15 - 2) + offset) & 0xFFFFFFFE) + 4;
+                fprintf(out, "    if (aot_condition(cpu, %u)) { cpu->r[15] = 0x%08Xu; return cycles + %u; }\n",
+                        (op >> 8) & 0xF, taken, pending + 3);
+                fprintf(out, "    cpu->r[15] = 0x%08Xu; return cycles + %u;\n", r15, pending + 1);
+            } else if ((op >> 11) == 0x1C) {
+                s32 offset = (s32)((u32)(op & 0x7FF) << 21) >> 20;
+                fprintf(out, "    cpu->r[15] = 0x%08Xu; return cycles + %u;\n", (r15 + offset) & 0xFFFFFFFE, pending + 3);
+            } else {
+                gen_handler_call(out, "return cycles + ", r15, pending, op);
+            }
+            fprintf(out, "}\n\n");
+            return;
+        }
+        
+        if (!gen_native(out, op, r15, &pending)) {
+            gen_handler_call(out, "cycles += ", r15, pending, op);
+            pending = 0;
+        }
+    }
+    
+    // Length limit: R15 points at the next block like in the interpreter
+    fprintf(out, "    cpu->r[15] = 0x%08Xu; return cycles + %u;\n", addr + 4, pending);
+    fprintf(out, "}\n\n");
+}
+
+static FILE *open_output(const char *path, const char *rom_path) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "aot_gen: cannot write %s\n", path);
+        exit(1);
+    }
+    fprintf(out, "// Generated by aot_gen from %s - do not edit\n\n", rom_path);
+    fprintf(out, "#include \"aot.h\"\n\n");
+    return out;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    u32 x = *(const u32*)a, y = *(const u32*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <rom.gba> <out_prefix> [symbols.txt]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        fprintf(stderr, "aot_gen: cannot open %s\n", argv[1]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    rom_size = (u32)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    rom = (u8*)malloc(rom_size);
+    visited = (u8*)calloc((rom_size >> 4) + 1, 1);
+    if (!rom || !visited || fread(rom, 1, rom_size, f) != rom_size) {
+        fprintf(stderr, "aot_gen: cannot read %s\n", argv[1]);
+        return 1;
+    }
+    fclose(f);
+
+    // Entries from the symbol file first, then every BL target
+    u32 entries = 0;
+    if (argc > 3) {
+        FILE *syms = fopen(argv[3], "r");
+        if (!syms) {
+            fprintf(stderr, "aot_gen: cannot open %s\n", argv[3]);
+            return 1;
+        }
+        char line[512];
+        while (fgets(line, sizeof(line), syms)) {
+            u32 addr = (u32)strtoul(line, NULL, 16);
+            if (addr >= ROM_BASE && addr < ROM_BASE + rom_size) {
+                if (walk_function(addr & ~1u)) entries++;
+            }
+        }
+        fclose(syms);
+    }
+
+    for (u32 addr = ROM_BASE; addr + 3 < ROM_BASE + rom_size; addr += 2) {
+        u16 hi = rom_read16(addr);
+        u16 lo = rom_read16(addr + 2);
+        if ((hi >> 11) != 0x1E || (lo >> 11) != 0x1F) continue;
+        
+        s32 offset = (s32)((u32)(hi & 0x7FF) << 21) >> 9;
+        u32 target = addr + 4 + offset + ((lo & 0x7FF) << 1);
+        // Only targets starting with PUSH: BL-shaped pairs in data point
+        // almost anywhere, real functions with a frame start like this
+        if (in_rom(target) && (rom_read16(target) & 0xFE00) == 0xB400) {
+            if (walk_function(target)) entries++;
+        }
+    }
+
+    qsort(blocks, block_count, sizeof(u32), compare_u32);
+
+    u32 index_size = 1;
+    while (index_size < block_count * 2) index_size <<= 1;
+    u32 *index = (u32*)calloc(index_size, sizeof(u32));
+    if (!index) {
+        fprintf(stderr, "aot_gen: out of memory\n");
+        return 1;
+    }
+    for (u32 i = 0; i < block_count; i++) {
+        u32 slot = (blocks[i] >> 1) & (index_size - 1);
+        while (index[slot]) slot = (slot + 1) & (index_size - 1);
+        index[slot] = i + 1;
+    }
+
+    u64 hash = 0xCBF29CE484222325ULL;
+    for (u32 i = 0; i < rom_size; i++) {
+        hash ^= rom[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    // Blocks are spread over AOT_SHARDS files so they build in parallel
+    char path[1024];
+    for (u32 shard = 0; shard < AOT_SHARDS; shard++) {
+        snprintf(path, sizeof(path), "%s_%u.c", argv[2], shard);
+        FILE *out = open_output(path, argv[1]);
+        for (u32 i = shard; i < block_count; i += AOT_SHARDS) {
+            gen_block(out, blocks[i]);
+        }
+        fclose(out);
+    }
+
+    snprintf(path, sizeof(path), "%s.c", argv[2]);
+    FILE *out = open_output(path, argv[1]);
+    for (u32 i = 0; i < block_count; i++) {
+        fprintf(out, "u32 aot_%08X(ARM7TDMI *cpu, Memory *mem);\n", blocks[i]);
+    }
+    fprintf(out, "\n");
+
+    fprintf(out, "static const AotBlock aot_blocks[%u] = {\n", block_count ? block_count : 1);
+    for (u32 i = 0; i < block_count; i++) {
+        fprintf(out, "    { 0x%08Xu, aot_%08X },\n", blocks[i], blocks[i]);
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const u32 aot_index[%u] = {", index_size);
+    for (u32 i = 0; i < index_size; i++) {
+        fprintf(out, "%s%u,", (i % 16) ? " " : "\n    ", index[i]);
+    }
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "const AotProgram aot_program = {\n");
+    fprintf(out, "    0x%016llXULL, %uu, aot_blocks, %uu, aot_index, 0x%Xu\n",
+            (unsigned long long)hash, rom_size, block_count, index_size - 1);
+    fprintf(out, "};\n");
+    fclose(out);
+
+    printf("aot_gen: %u function entries, %u blocks\n", entries, block_count);
+
+    free(index);
+    free(blocks);
+    free(visited);
+    free(rom);
+    return 0;
+}
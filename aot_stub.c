@@ -0,0 +1,4 @@
+#include "aot.h"
+
+// Used when no ROM was translated at build time (EMERALD_AOT_ROM unset)
+const AotProgram aot_program = { 0, 0, NULL, 0, NULL, 0 };
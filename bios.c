@@ -5,10 +5,11 @@
 // GBA BIOS stub - provides minimal boot functionality
 // Real BIOS is 16KB, we provide essential parts
 
-static u8 bios_memory[0x4000]; // 16KB BIOS region
+// The image lives in each emulator's Memory (BIOS_SIZE bytes), so instances
+// never share it
 
-void bios_init(void) {
-    memset(bios_memory, 0, sizeof(bios_memory));
+void bios_init(u8 *bios_memory) {
+    memset(bios_memory, 0, BIOS_SIZE);
     
     // Write ARM exception vectors at the start of BIOS
     // Keep vectors simple - just loop on exceptions (game shouldn't hit these normally)
@@ -69,7 +70,7 @@ void bios_init(void) {
     // SWI calls via HLE in cpu_core.c
     
     // Fill remaining BIOS with ARM NOP (0xE1A00000 = mov r0, r0)
-    for (int i = 0x20; i < 0x4000; i += 4) {
+    for (int i = 0x20; i < BIOS_SIZE; i += 4) {
         bios_memory[i + 0] = 0x00;
         bios_memory[i + 1] = 0x00;
         bios_memory[i + 2] = 0xA0;
@@ -77,21 +78,21 @@ void bios_init(void) {
     }
 }
 
-u8 bios_read8(u32 addr) {
-    if (addr < 0x4000) {
+u8 bios_read8(const u8 *bios_memory, u32 addr) {
+    if (addr < BIOS_SIZE) {
         return bios_memory[addr];
     }
     return 0;
 }
 
-u16 bios_read16(u32 addr) {
+u16 bios_read16(const u8 *bios_memory, u32 addr) {
     if (addr < 0x3FFF) {
         return bios_memory[addr] | (bios_memory[addr + 1] << 8);
     }
     return 0;
 }
 
-u32 bios_read32(u32 addr) {
+u32 bios_read32(const u8 *bios_memory, u32 addr) {
     if (addr < 0x3FFD) {
         return bios_memory[addr] | 
                (bios_memory[addr + 1] << 8) | 
@@ -101,21 +102,21 @@ u32 bios_read32(u32 addr) {
     return 0;
 }
 
-void bios_write8(u32 addr, u8 value) {
+void bios_write8(u8 *bios_memory, u32 addr, u8 value) {
     // BIOS is read-only in hardware, but allow writes to flags area
     if (addr >= 0xDC && addr < 0x100) {
         bios_memory[addr] = value;
     }
 }
 
-void bios_write16(u32 addr, u16 value) {
+void bios_write16(u8 *bios_memory, u32 addr, u16 value) {
     if (addr >= 0xDC && addr < 0xFF) {
         bios_memory[addr] = value & 0xFF;
         bios_memory[addr + 1] = (value >> 8) & 0xFF;
     }
 }
 
-void bios_write32(u32 addr, u32 value) {
+void bios_write32(u8 *bios_memory, u32 addr, u32 value) {
     if (addr >= 0xDC && addr < 0xFD) {
         bios_memory[addr] = value & 0xFF;
         bios_memory[addr + 1] = (value >> 8) & 0xFF;
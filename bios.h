@@ -3,16 +3,18 @@
 
 #include "types.h"
 
-// Initialize BIOS emulation
-void bios_init(void);
+#define BIOS_SIZE 0x4000  // 16 KB
+
+// Initialize BIOS emulation (fills a BIOS_SIZE image owned by the caller)
+void bios_init(u8 *bios);
 
 // BIOS memory access
-u8 bios_read8(u32 addr);
-u16 bios_read16(u32 addr);
-u32 bios_read32(u32 addr);
+u8 bios_read8(const u8 *bios, u32 addr);
+u16 bios_read16(const u8 *bios, u32 addr);
+u32 bios_read32(const u8 *bios, u32 addr);
 
-void bios_write8(u32 addr, u8 value);
-void bios_write16(u32 addr, u16 value);
-void bios_write32(u32 addr, u32 value);
+void bios_write8(u8 *bios, u32 addr, u8 value);
+void bios_write16(u8 *bios, u32 addr, u16 value);
+void bios_write32(u8 *bios, u32 addr, u32 value);
 
 #endif // BIOS_H
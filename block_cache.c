@@ -0,0 +1,106 @@
+#include "block_cache.h"
+#include <stdlib.h>
+#include <string.h>
+
+static inline u32 block_hash(u32 pc, bool thumb) {
+    return ((pc >> 1) ^ (pc >> 13) ^ (thumb ? 0x800 : 0)) & (BLOCK_CACHE_BUCKETS - 1);
+}
+
+BlockCache *block_cache_create(void) {
+    BlockCache *cache = (BlockCache*)calloc(1, sizeof(BlockCache));
+    if (!cache) return NULL;
+    
+    cache->pool = (CachedBlock*)malloc(sizeof(CachedBlock) * BLOCK_CACHE_CAPACITY);
+    if (!cache->pool) {
+        free(cache);
+        return NULL;
+    }
+    
+    return cache;
+}
+
+void block_cache_destroy(BlockCache *cache) {
+    if (!cache) return;
+    
+    free(cache->pool);
+    free(cache);
+}
+
+void block_cache_flush(BlockCache *cache) {
+    if (!cache) return;
+    
+    memset(cache->buckets, 0, sizeof(cache->buckets));
+    cache->pool_used = 0;
+    
+    // Bump every page that held code so nothing can match an old version
+    for (u32 i = 0; i < BLOCK_EWRAM_PAGES; i++) {
+        if (cache->ewram_code[i]) cache->ewram_version[i]++;
+    }
+    for (u32 i = 0; i < BLOCK_IWRAM_PAGES; i++) {
+        if (cache->iwram_code[i]) cache->iwram_version[i]++;
+    }
+    memset(cache->ewram_code, 0, sizeof(cache->ewram_code));
+    memset(cache->iwram_code, 0, sizeof(cache->iwram_code));
+}
+
+bool block_cache_is_cacheable(u32 addr) {
+    return (addr >= 0x02000000 && addr < 0x04000000) ||
+           (addr >= 0x08000000 && addr < 0x0E000000);
+}
+
+CachedBlock *block_cache_lookup(BlockCache *cache, u32 pc, bool thumb) {
+    CachedBlock *block = cache->buckets[block_hash(pc, thumb)];
+    
+    while (block) {
+        if (block->pc == pc && block->thumb == thumb) {
+            if (block->page_version && *block->page_version != block->version) {
+                return NULL; // Code was overwritten since translation
+            }
+            return block;
+        }
+        block = block->next;
+    }
+    return NULL;
+}
+
+CachedBlock *block_cache_alloc(BlockCache *cache, u32 pc, bool thumb) {
+    u32 bucket = block_hash(pc, thumb);
+    CachedBlock *block = cache->buckets[bucket];
+    
+    // Reuse a stale translation of the same address
+    while (block) {
+        if (block->pc == pc && block->thumb == thumb) break;
+        block = block->next;
+    }
+    
+    if (!block) {
+        if (cache->pool_used == BLOCK_CACHE_CAPACITY) {
+            block_cache_flush(cache);
+        }
+        block = &cache->pool[cache->pool_used++];
+        block->pc = pc;
+        block->thumb = thumb;
+        block->next = cache->buckets[bucket];
+        cache->buckets[bucket] = block;
+    }
+    
+    block->count = 0;
+    block->idle_loop = false;
+    block->page_version = NULL;
+    block->version = 0;
+    
+    if (pc >= 0x02000000 && pc < 0x03000000) {
+        u32 page = ((pc - 0x02000000) % EWRAM_SIZE) >> BLOCK_PAGE_SHIFT;
+        cache->ewram_code[page] = 1;
+        block->page_version = &cache->ewram_version[page];
+    } else if (pc >= 0x03000000 && pc < 0x04000000) {
+        u32 page = ((pc - 0x03000000) % IWRAM_SIZE) >> BLOCK_PAGE_SHIFT;
+        cache->iwram_code[page] = 1;
+        block->page_version = &cache->iwram_version[page];
+    }
+    if (block->page_version) {
+        block->version = *block->page_version;
+    }
+    
+    return block;
+}
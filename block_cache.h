@@ -0,0 +1,86 @@
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include "types.h"
+#include "cpu_core.h"
+
+// Cache of pre-decoded basic blocks for the interpreter
+//
+// Blocks are keyed by guest address and Thumb/ARM state. Code in ROM is never
+// invalidated. Code in EWRAM/IWRAM is tracked per 256-byte page: a write to a
+// page holding translated code bumps the page version, and any block built
+// from an older version is re-translated the next time it is looked up.
+
+#define BLOCK_CACHE_BUCKETS   4096   // Hash buckets (power of two)
+#define BLOCK_CACHE_CAPACITY  8192   // Blocks in the pool before a full flush
+#define BLOCK_MAX_INSTRS      32     // Longest block we translate
+
+#define BLOCK_PAGE_SHIFT      8      // 256-byte invalidation pages
+#define BLOCK_EWRAM_PAGES     (EWRAM_SIZE >> BLOCK_PAGE_SHIFT)
+#define BLOCK_IWRAM_PAGES     (IWRAM_SIZE >> BLOCK_PAGE_SHIFT)
+
+typedef struct CachedInstr {
+    u32 opcode;
+    union {
+        ArmHandler arm;
+        ThumbHandler thumb;
+    } handler;
+} CachedInstr;
+
+typedef struct CachedBlock {
+    u32 pc;                      // Address of the first instruction
+    bool thumb;                  // Thumb or ARM code
+    u8 count;                    // Instructions in the block
+    bool idle_loop;              // Branches back to pc without storing anything
+    u32 *page_version;           // Version counter of the RAM page (NULL in ROM)
+    u32 version;                 // Page version the block was translated from
+    struct CachedBlock *next;    // Hash chain
+    CachedInstr instrs[BLOCK_MAX_INSTRS];
+} CachedBlock;
+
+typedef struct BlockCache {
+    CachedBlock *buckets[BLOCK_CACHE_BUCKETS];
+    CachedBlock *pool;           // BLOCK_CACHE_CAPACITY blocks
+    u32 pool_used;
+
+    u32 ewram_version[BLOCK_EWRAM_PAGES];
+    u32 iwram_version[BLOCK_IWRAM_PAGES];
+    u8 ewram_code[BLOCK_EWRAM_PAGES];    // Page holds translated code
+    u8 iwram_code[BLOCK_IWRAM_PAGES];
+} BlockCache;
+
+// Create/destroy a cache (returns NULL on allocation failure)
+BlockCache *block_cache_create(void);
+void block_cache_destroy(BlockCache *cache);
+
+// Drop every translated block (e.g. after reset or loading a state)
+void block_cache_flush(BlockCache *cache);
+
+// True if code at this address may be cached (BIOS and I/O never are)
+bool block_cache_is_cacheable(u32 addr);
+
+// Look up a block that is still valid, or NULL
+CachedBlock *block_cache_lookup(BlockCache *cache, u32 pc, bool thumb);
+
+// Get an empty block for pc, reusing a stale entry if one exists.
+// The caller fills in instrs/count.
+CachedBlock *block_cache_alloc(BlockCache *cache, u32 pc, bool thumb);
+
+// Called by mem_write8 for EWRAM/IWRAM offsets
+static inline void block_cache_ewram_write(BlockCache *cache, u32 offset) {
+    u32 page = offset >> BLOCK_PAGE_SHIFT;
+    if (cache->ewram_code[page]) {
+        cache->ewram_code[page] = 0;
+        cache->ewram_version[page]++;
+    }
+}
+
+static inline void block_cache_iwram_write(BlockCache *cache, u32 offset) {
+    u32 page = offset >> BLOCK_PAGE_SHIFT;
+    if (cache->iwram_code[page]) {
+        cache->iwram_code[page] = 0;
+        cache->iwram_version[page]++;
+    }
+}
+
+#endif // BLOCK_CACHE_H
@@ -1,41 +1,125 @@
-#ifndef CPU_CORE_H
-#define CPU_CORE_H
-
-#include "types.h"
-#include "memory.h"
-
-// Forward declaration
-typedef struct InterruptState InterruptState;
-
-// CPU Status flags
-#define FLAG_N  (1 << 31)  // Negative
-#define FLAG_Z  (1 << 30)  // Zero
-#define FLAG_C  (1 << 29)  // Carry
-#define FLAG_V  (1 << 28)  // Overflow
-#define FLAG_T  (1 <<  5)  // Thumb mode
-#define FLAG_I  (1 <<  7)  // IRQ disable
-
-typedef struct {
-    u32 r[16];           // R0-R15 (R13=SP, R14=LR, R15=PC)
-    u32 cpsr;            // Current Program Status Register
-    u32 spsr;            // Saved PSR
-    bool thumb_mode;     // true = Thumb, false = ARM
-    u64 cycles;          // Total cycles executed
-    bool halted;         // CPU halted flag
-} ARM7TDMI;
-
-// Initialize CPU
-void cpu_init(ARM7TDMI *cpu);
-void cpu_reset(ARM7TDMI *cpu);
-
-// Execution
-void cpu_execute_frame(ARM7TDMI *cpu, Memory *mem, InterruptState *interrupts);
-u32 cpu_step(ARM7TDMI *cpu, Memory *mem);
-void cpu_handle_interrupt(ARM7TDMI *cpu, Memory *mem);
-
-// Helper functions
-void cpu_set_flag(ARM7TDMI *cpu, u32 flag);
-void cpu_clear_flag(ARM7TDMI *cpu, u32 flag);
-bool cpu_get_flag(ARM7TDMI *cpu, u32 flag);
-
-#endif // CPU_CORE_H
+#ifndef CPU_CORE_H
+#define CPU_CORE_H
+
+#include "types.h"
+#include "memory.h"
+#include "debug_trace.h"
+
+// Forward declaration
+typedef struct InterruptState InterruptState;
+
+// CPU Status flags
+#define FLAG_N  (1 << 31)  // Negative
+#define FLAG_Z  (1 << 30)  // Zero
+#define FLAG_C  (1 << 29)  // Carry
+#define FLAG_V  (1 << 28)  // Overflow
+#define FLAG_T  (1 <<  5)  // Thumb mode
+#define FLAG_I  (1 <<  7)  // IRQ disable
+
+// Lazy condition flags
+//
+// Flag-setting instructions only record what they computed; N/Z/C/V are
+// folded into cpsr by cpu_sync_flags() when something actually looks at
+// them (conditions, MRS/MSR, carry-in, exceptions). N/Z and C/V are tracked
+// separately so a logical op doesn't have to settle a pending add's carry.
+#define FLAGS_NONE  0  // cpsr holds the current flags
+#define FLAGS_NZ    1  // N/Z from flag_result
+#define FLAGS_ADD   2  // C/V from flag_a + flag_b = flag_cv
+#define FLAGS_SUB   4  // C/V from flag_a - flag_b = flag_cv
+
+// Rate limits and last-seen values for the diagnostic printfs in cpu_core.c
+// (per CPU, so concurrent emulators don't share them)
+typedef struct CpuDebug {
+    u32 logged_mov_pc;        // Last PC that logged an invalid MOV/LDR/BX target
+    u32 logged_ldr_pc;
+    u32 logged_bx;
+    int bx_zero_count;        // BX into the BIOS vectors
+    int bx_lr_count;
+    u32 bl_count;
+    u32 last_blx_target;
+    int consecutive_in_loop;  // Known wait-loop detector (cpu_prepare_fetch)
+    int pc_stuck_count;
+    int trace_stuck_loop;
+    int load_r4_count;
+    u32 last_r4;
+    int misalign_count;
+    int cpsr_log_count;
+    u32 last_bad_pc;
+    u32 last_exception_pc;
+    int bx_to_bios_count;
+    u32 last_vector_pc;
+    int pf_debug_count;
+} CpuDebug;
+
+// Host side of the CPU: diagnostics that are not guest state. Lives after
+// Memory in the GuestState arena and is reached through mem->cpu_host.
+typedef struct CpuHost {
+    CpuDebug debug;       // Diagnostic log state
+    DebugTrace trace;     // Instruction trace (main.c enables it for stuck boots)
+} CpuHost;
+
+typedef struct {
+    u32 r[16];           // R0-R15 (R13=SP, R14=LR, R15=PC)
+    u32 cpsr;            // Current Program Status Register (NZCV may be stale, see flag_op)
+    u32 spsr;            // Saved PSR
+    u32 flag_op;         // Pending flag state (FLAGS_* bits)
+    u32 flag_result;     // Result of the last flag-setting instruction
+    u32 flag_a;          // Operands and result of the last add/sub
+    u32 flag_b;
+    u32 flag_cv;
+    bool thumb_mode;     // true = Thumb, false = ARM
+    u64 cycles;          // Total cycles executed
+    bool halted;         // CPU halted flag
+} ARM7TDMI;
+
+// Instruction handlers used by the decode tables and the block cache
+typedef u32 (*ArmHandler)(ARM7TDMI *cpu, Memory *mem, u32 opcode);
+typedef u32 (*ThumbHandler)(ARM7TDMI *cpu, Memory *mem, u16 opcode);
+
+// Initialize CPU
+void cpu_init(ARM7TDMI *cpu);
+void cpu_reset(ARM7TDMI *cpu);
+void cpu_host_init(CpuHost *host);
+
+// Execution
+void cpu_execute_frame(ARM7TDMI *cpu, Memory *mem, InterruptState *interrupts);
+u32 cpu_step(ARM7TDMI *cpu, Memory *mem);
+u32 cpu_run_block(ARM7TDMI *cpu, Memory *mem);  // Run one cached basic block
+u32 cpu_run(ARM7TDMI *cpu, Memory *mem, u32 budget);  // Run blocks (chained under the JIT) up to ~budget cycles
+void cpu_handle_interrupt(ARM7TDMI *cpu, Memory *mem);
+
+// Decoder access for the recompiler
+ThumbHandler cpu_thumb_handler(u16 opcode);
+bool cpu_thumb_ends_block(u16 opcode);
+
+// Bring cpsr up to date with the last flag-setting instructions
+static inline void cpu_sync_flags(ARM7TDMI *cpu) {
+    u32 op = cpu->flag_op;
+    if (op == FLAGS_NONE) return;
+    
+    u32 cpsr = cpu->cpsr;
+    if (op & (FLAGS_ADD | FLAGS_SUB)) {
+        u32 a = cpu->flag_a, b = cpu->flag_b, result = cpu->flag_cv;
+        cpsr &= ~(FLAG_C | FLAG_V);
+        if (op & FLAGS_ADD) {
+            if (result < a) cpsr |= FLAG_C;
+            if ((~(a ^ b) & (a ^ result)) >> 31) cpsr |= FLAG_V;
+        } else {
+            if (a >= b) cpsr |= FLAG_C;
+            if (((a ^ b) & (a ^ result)) >> 31) cpsr |= FLAG_V;
+        }
+    }
+    if (op & FLAGS_NZ) {
+        u32 result = cpu->flag_result;
+        cpsr = (cpsr & ~(FLAG_N | FLAG_Z)) | (result & FLAG_N) | (result ? 0 : FLAG_Z);
+    }
+    cpu->cpsr = cpsr;
+    cpu->flag_op = FLAGS_NONE;
+}
+
+// Helper functions
+void cpu_set_flag(ARM7TDMI *cpu, u32 flag);
+void cpu_clear_flag(ARM7TDMI *cpu, u32 flag);
+bool cpu_get_flag(ARM7TDMI *cpu, u32 flag);
+
+#endif // CPU_CORE_H
@@ -4,19 +4,22 @@
 #include "types.h"
 #include <stdbool.h>
 
-// Debug tracing configuration
-extern bool debug_trace_enabled;
-extern u32 debug_trace_start_pc;
-extern u32 debug_trace_end_pc;
-extern int debug_trace_max_instructions;
+// Debug tracing configuration (one per CPU, see CpuHost.trace)
+typedef struct DebugTrace {
+    bool enabled;
+    u32 start_pc;
+    u32 end_pc;
+    int max_instructions;
+    int count;            // Instructions traced so far
+} DebugTrace;
 
-// Initialize debug tracing
-void debug_trace_init(void);
+// Initialize debug tracing (disabled, default PC window)
+void debug_trace_init(DebugTrace *trace);
 
 // Log a single instruction execution
-void debug_trace_instruction(u32 pc, u32 opcode, bool is_thumb, const char* disasm);
+void debug_trace_instruction(DebugTrace *trace, u32 pc, u32 opcode, bool is_thumb, const char* disasm);
 
 // Check if we should trace this PC
-bool debug_should_trace(u32 pc);
+bool debug_should_trace(const DebugTrace *trace, u32 pc);
 
 #endif // DEBUG_TRACE_H
@@ -0,0 +1,42 @@
+#ifndef EMULATOR_H
+#define EMULATOR_H
+
+#include "types.h"
+#include "guest_state.h"
+#include "block_cache.h"
+#include "jit_x64.h"
+#include "rewind.h"
+#include "game_state.h"
+
+// One emulator instance of the shared library (python_api.c). Save states
+// (save_state.c) capture the guest arena; the ROM, the code caches, the
+// screen conversion buffer and render policy, the native reward baseline, the
+// rewind history and the fork bookkeeping stay with the instance.
+typedef struct EmulatorState {
+    GuestState *guest;    // CPU, memory, devices and framebuffer (one arena)
+    BlockCache *block_cache;
+    JitState *jit;
+    u8 *rom_data;
+    u32 rom_size;
+    bool owns_rom;        // false when the ROM is shared by a batch
+    u32 screen_format;    // EMU_SCREEN_*
+    u8 screen[GBA_FRAMEBUFFER_SIZE * 3]; // Converted screen (RGB888 / GRAY8 formats)
+    u32 render_policy;    // EMU_RENDER_*
+    u32 render_interval;  // Frames per render for EMU_RENDER_EVERY_N
+    bool screen_stale;    // Lazy rendering owes the last frame (see emu_set_render_policy)
+    u16 pool_frame[GBA_FRAMEBUFFER_SIZE]; // Next-to-last frame of a max-pooled emu_step_n
+    bool pool_pending;    // The next render is max-pooled with pool_frame (emu_step_n)
+    RewardState reward;   // Baseline of the native reward (EMU_STEP_REWARD)
+    RewindBuffer *rewind;  // Per-frame history (NULL = off, see emu_rewind_enable)
+    u8 *rewind_state;      // Buffer the history rebuilds a state into
+    
+    // Forks (emu_fork). A parent owns every child it ever forked; a released
+    // child stays in the list, idle, and is re-synced by the next fork.
+    struct EmulatorState *fork_parent;   // NULL for an instance made by emu_init
+    struct EmulatorState *fork_children; // First child
+    struct EmulatorState *fork_next;     // Next child of the same parent
+    bool fork_idle;                      // Released, waiting for reuse
+    u64 fork_stale[MEM_DIRTY_WORDS];     // Pages that may differ from the parent's last fork
+} EmulatorState;
+
+#endif // EMULATOR_H
@@ -1,23 +1,29 @@
-#ifndef GFX_RENDERER_H
-#define GFX_RENDERER_H
-
-#include "types.h"
-#include "memory.h"
-#include <SDL.h>
-
-typedef struct CPU CPU;
-typedef struct InterruptState InterruptState;
-
-typedef struct {
-    u16 framebuffer[GBA_FRAMEBUFFER_SIZE];
-    bool dirty;
-    bool show_debug;
-} GFXState;
-
-void gfx_init(GFXState *gfx);
-void gfx_render_frame(GFXState *gfx, Memory *mem);
-void gfx_present(GFXState *gfx, SDL_Renderer *renderer);
-void gfx_draw_debug_info(GFXState *gfx, Memory *mem, u32 pc, u32 sp, u32 lr, u32 cpsr, bool thumb, 
-                         u16 ie, u16 if_flag, u16 ime, u64 frame_count);
-
-#endif // GFX_RENDERER_H
+#ifndef GFX_RENDERER_H
+#define GFX_RENDERER_H
+
+#include "types.h"
+#include "memory.h"
+#include <SDL.h>
+
+typedef struct CPU CPU;
+typedef struct InterruptState InterruptState;
+typedef struct GfxCache GfxCache;
+
+// Renderer state. Host side only: the frame it draws into is guest state
+// (GuestState.framebuffer), everything here belongs to this instance.
+typedef struct {
+    u16 *framebuffer;     // GBA_FRAMEBUFFER_SIZE pixels, set by gfx_init
+    bool dirty;
+    bool show_debug;
+    SDL_Texture *texture; // Created by gfx_present on first use
+    GfxCache *cache;      // Decoded video memory, created by gfx_render_frame on first use
+} GFXState;
+
+void gfx_init(GFXState *gfx, u16 *framebuffer);
+void gfx_cleanup(GFXState *gfx);
+void gfx_render_frame(GFXState *gfx, Memory *mem);
+void gfx_present(GFXState *gfx, SDL_Renderer *renderer);
+void gfx_draw_debug_info(GFXState *gfx, Memory *mem, u32 pc, u32 sp, u32 lr, u32 cpsr, bool thumb, 
+                         u16 ie, u16 if_flag, u16 ime, u64 frame_count);
+
+#endif // GFX_RENDERER_H
@@ -0,0 +1,76 @@
+#include "guest_state.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+GuestState *guest_create(void) {
+    // aligned_alloc wants a multiple of the alignment
+    size_t size = (sizeof(GuestState) + GUEST_ALIGN - 1) & ~(size_t)(GUEST_ALIGN - 1);
+#ifdef _WIN32
+    GuestState *guest = (GuestState*)_aligned_malloc(size, GUEST_ALIGN);
+#else
+    GuestState *guest = (GuestState*)aligned_alloc(GUEST_ALIGN, size);
+#endif
+    if (!guest) return NULL;
+    
+    memset(guest, 0, sizeof(GuestState));
+    guest_init(guest);
+    return guest;
+}
+
+void guest_destroy(GuestState *guest) {
+    if (!guest) return;
+    
+    mem_cleanup(&guest->memory);
+    gfx_cleanup(&guest->gfx);
+#ifdef _WIN32
+    _aligned_free(guest);
+#else
+    free(guest);
+#endif
+}
+
+void guest_init(GuestState *guest) {
+    cpu_init(&guest->cpu);
+    mem_init(&guest->memory);
+    interrupt_init(&guest->interrupts);
+    timer_init(&guest->timers);
+    dma_init(&guest->dma);
+    rtc_init(&guest->rtc);
+    scheduler_init(&guest->scheduler);
+    input_init(&guest->input);
+    gfx_init(&guest->gfx, guest->framebuffer);
+    cpu_host_init(&guest->cpu_host);
+    guest->frame_count = 0;
+    
+    guest_link(guest);
+}
+
+void guest_link(GuestState *guest) {
+    Memory *mem = &guest->memory;
+    mem_set_interrupts(mem, &guest->interrupts);
+    mem_set_timers(mem, &guest->timers);
+    mem_set_dma(mem, &guest->dma);
+    mem_set_rtc(mem, &guest->rtc);
+    mem_set_scheduler(mem, &guest->scheduler);
+    mem_set_cpu_host(mem, &guest->cpu_host);
+}
+
+void guest_save(const GuestState *guest, void *buffer) {
+    memcpy(buffer, guest, GUEST_STATE_BYTES);
+}
+
+void guest_load(GuestState *guest, const void *buffer) {
+    memcpy(guest, buffer, GUEST_STATE_BYTES);
+    
+    // Every page may differ from what the caller last saw
+    mem_mark_all_dirty(&guest->memory);
+}
+
+void guest_sync(GuestState *guest, const GuestState *source, const u64 *pages) {
+    memcpy(guest, source, offsetof(GuestState, memory));
+    mem_copy_pages(&guest->memory, &source->memory, pages);
+}
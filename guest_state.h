@@ -0,0 +1,66 @@
+#ifndef GUEST_STATE_H
+#define GUEST_STATE_H
+
+#include "types.h"
+#include "cpu_core.h"
+#include "memory.h"
+#include "gfx_renderer.h"
+#include "input.h"
+#include "interrupts.h"
+#include "timer.h"
+#include "dma.h"
+#include "rtc.h"
+#include "scheduler.h"
+
+// Guest state arena
+//
+// Every component the guest can change lives by value in one cache-aligned
+// block. The components hold no pointers, and Memory keeps its guest bytes
+// in front of its host fields (ROM, component links, lookup tables). Memory
+// goes last among them, so the whole guest state is the first
+// GUEST_STATE_BYTES of the arena: a snapshot or a restore is one memcpy.
+// Host-only state (renderer, CPU diagnostics) sits after Memory, outside
+// that range, and stays with the instance across restores.
+#define GUEST_ALIGN 64
+
+typedef struct GuestState {
+    ARM7TDMI cpu;
+    InterruptState interrupts;
+    TimerState timers;
+    DMAState dma;
+    RTCState rtc;
+    Scheduler scheduler;
+    InputState input;
+    u64 frame_count;
+    u16 framebuffer[GBA_FRAMEBUFFER_SIZE]; // Last rendered frame (RGB565)
+    _Alignas(GUEST_ALIGN) Memory memory; // Guest bytes end here, see MEM_GUEST_BYTES
+    
+    // Host side
+    GFXState gfx;         // Renderer (SDL texture, render cache) drawing into framebuffer
+    CpuHost cpu_host;     // CPU log state and instruction trace
+} GuestState;
+
+#define GUEST_STATE_BYTES (offsetof(GuestState, memory) + MEM_GUEST_BYTES)
+
+// Allocate a GUEST_ALIGN-aligned arena in power-on state (NULL on failure)
+GuestState *guest_create(void);
+void guest_destroy(GuestState *guest);
+
+// Power-on state of every component; Memory is linked to the others
+void guest_init(GuestState *guest);
+
+// Point Memory at the components of this arena
+void guest_link(GuestState *guest);
+
+// Copy the guest state (GUEST_STATE_BYTES) out of / into an arena. A state
+// can be loaded into any arena running the same ROM; the caller flushes the
+// block cache afterwards since cached RAM code may no longer match.
+void guest_save(const GuestState *guest, void *buffer);
+void guest_load(GuestState *guest, const void *buffer);
+
+// Make an arena equal to source when only the Memory pages set in 'pages'
+// (MEM_DIRTY_WORDS words) can differ; the other components are copied whole.
+// Used by forks, see emu_fork.
+void guest_sync(GuestState *guest, const GuestState *source, const u64 *pages);
+
+#endif // GUEST_STATE_H
@@ -0,0 +1,864 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE  // MAP_ANONYMOUS
+#endif
+
+#include "jit_x64.h"
+#include "memory.h"
+#include "interrupts.h"
+#include "block_cache.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if JIT_X64_AVAILABLE
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#define JIT_CODE_SIZE       (16 * 1024 * 1024)  // Executable buffer
+#define JIT_BLOCK_MAX_BYTES 8192                // Worst case for one block
+#define JIT_MAP_SIZE        (1 << 16)           // Translated block slots (power of two)
+#define JIT_MAX_PATCHES     (1 << 16)           // Chain jumps waiting for a target
+
+typedef u32 (*JitEnterFn)(ARM7TDMI *cpu, Memory *mem, void *code, u32 budget);
+
+typedef struct {
+    u32 pc;        // Guest address (0 = empty slot)
+    u8 *code;      // Native entry point
+} JitEntry;
+
+typedef struct {
+    u32 target_pc; // Block the jump wants to reach
+    u8 *site;      // rel32 operand of the jump
+} JitPatch;
+
+struct JitState {
+    u8 *code;              // JIT_CODE_SIZE bytes, read/write/execute
+    u32 code_used;
+    u32 code_base;         // Offset where translated blocks start
+    JitEnterFn enter;      // Trampoline from C into a block
+    u8 *exit_stub;         // Common epilogue back to C
+    u32 map_count;
+    JitEntry map[JIT_MAP_SIZE];
+    u32 patch_count;
+    JitPatch patches[JIT_MAX_PATCHES];
+};
+
+// x86-64 registers
+enum {
+    RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+    R8 = 8, R9 = 9, R10 = 10, R11 = 11, R12 = 12, R13 = 13, R14 = 14, R15 = 15
+};
+
+// Register roles inside translated code:
+//   RBX = ARM7TDMI*, R12 = Memory*, R13 = cycles this call, R14 = budget
+#ifdef _WIN32
+#define ARG0 RCX
+#define ARG1 RDX
+#define ARG2 R8
+#define ARG3 R9
+#else
+#define ARG0 RDI
+#define ARG1 RSI
+#define ARG2 RDX
+#define ARG3 RCX
+#endif
+
+// Condition codes for Jcc/SETcc
+enum {
+    CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5
+};
+
+// ALU opcodes (op r/m32, r32)
+enum {
+    ALU_ADD = 0x01, ALU_OR = 0x09, ALU_AND = 0x21, ALU_SUB = 0x29,
+    ALU_XOR = 0x31, ALU_CMP = 0x39, ALU_TEST = 0x85, ALU_MOV = 0x89
+};
+
+// Group 1 extensions (op r/m32, imm32)
+enum { EXT_ADD = 0, EXT_OR = 1, EXT_AND = 4, EXT_SUB = 5, EXT_XOR = 6, EXT_CMP = 7 };
+
+// Shift group extensions
+enum { SHIFT_SHL = 4, SHIFT_SHR = 5, SHIFT_SAR = 7 };
+
+#define OFF_R(n)    ((s32)(offsetof(ARM7TDMI, r) + 4 * (n)))
+#define OFF_CPSR    ((s32)offsetof(ARM7TDMI, cpsr))
+#define OFF_FLAG_OP ((s32)offsetof(ARM7TDMI, flag_op))
+#define OFF_INTS    ((s32)offsetof(Memory, interrupts))
+#define OFF_IE      ((s32)offsetof(InterruptState, ie))
+#define OFF_IF      ((s32)offsetof(InterruptState, if_flag))
+#define OFF_IME     ((s32)offsetof(InterruptState, ime))
+
+typedef struct {
+    u8 *p;
+} Emitter;
+
+// ---------------------------------------------------------------------------
+// Instruction encoding
+// ---------------------------------------------------------------------------
+
+static void emit8(Emitter *e, u8 v) {
+    *e->p++ = v;
+}
+
+static void emit32(Emitter *e, u32 v) {
+    memcpy(e->p, &v, 4);
+    e->p += 4;
+}
+
+static void emit64(Emitter *e, u64 v) {
+    memcpy(e->p, &v, 8);
+    e->p += 8;
+}
+
+static void emit_rex(Emitter *e, bool w, int reg, int rm) {
+    u8 rex = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((rm & 8) ? 1 : 0);
+    if (rex != 0x40) emit8(e, rex);
+}
+
+// ModRM for [base + disp32]
+static void emit_mem(Emitter *e, int reg, int base, s32 disp) {
+    emit8(e, 0x80 | ((reg & 7) << 3) | (base & 7));
+    if ((base & 7) == RSP) emit8(e, 0x24);  // SIB needed for RSP/R12
+    emit32(e, (u32)disp);
+}
+
+static void emit_modrm_rr(Emitter *e, int reg, int rm) {
+    emit8(e, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// mov r32, [base + disp]
+static void emit_load32(Emitter *e, int reg, int base, s32 disp) {
+    emit_rex(e, false, reg, base);
+    emit8(e, 0x8B);
+    emit_mem(e, reg, base, disp);
+}
+
+// mov r64, [base + disp]
+static void emit_load64(Emitter *e, int reg, int base, s32 disp) {
+    emit_rex(e, true, reg, base);
+    emit8(e, 0x8B);
+    emit_mem(e, reg, base, disp);
+}
+
+// movzx r32, word [base + disp]
+static void emit_load16(Emitter *e, int reg, int base, s32 disp) {
+    emit_rex(e, false, reg, base);
+    emit8(e, 0x0F);
+    emit8(e, 0xB7);
+    emit_mem(e, reg, base, disp);
+}
+
+// mov [base + disp], r32
+static void emit_store32(Emitter *e, int base, s32 disp, int reg) {
+    emit_rex(e, false, reg, base);
+    emit8(e, 0x89);
+    emit_mem(e, reg, base, disp);
+}
+
+// mov dword [base + disp], imm32
+static void emit_store_imm32(Emitter *e, int base, s32 disp, u32 imm) {
+    emit_rex(e, false, 0, base);
+    emit8(e, 0xC7);
+    emit_mem(e, 0, base, disp);
+    emit32(e, imm);
+}
+
+static void emit_mov_imm32(Emitter *e, int reg, u32 imm) {
+    emit_rex(e, false, 0, reg);
+    emit8(e, 0xB8 + (reg & 7));
+    emit32(e, imm);
+}
+
+static void emit_mov_imm64(Emitter *e, int reg, u64 imm) {
+    emit_rex(e, true, 0, reg);
+    emit8(e, 0xB8 + (reg & 7));
+    emit64(e, imm);
+}
+
+// op dst, src (32-bit)
+static void emit_alu(Emitter *e, u8 op, int dst, int src) {
+    emit_rex(e, false, src, dst);
+    emit8(e, op);
+    emit_modrm_rr(e, src, dst);
+}
+
+// mov dst, src (64-bit)
+static void emit_mov64(Emitter *e, int dst, int src) {
+    emit_rex(e, true, src, dst);
+    emit8(e, 0x89);
+    emit_modrm_rr(e, src, dst);
+}
+
+// test r64, r64
+static void emit_test64(Emitter *e, int reg) {
+    emit_rex(e, true, reg, reg);
+    emit8(e, 0x85);
+    emit_modrm_rr(e, reg, reg);
+}
+
+// op dst, imm32
+static void emit_alu_imm(Emitter *e, int ext, int reg, u32 imm) {
+    emit_rex(e, false, 0, reg);
+    emit8(e, 0x81);
+    emit_modrm_rr(e, ext, reg);
+    emit32(e, imm);
+}
+
+// test r32, imm32
+static void emit_test_imm(Emitter *e, int reg, u32 imm) {
+    emit_rex(e, false, 0, reg);
+    emit8(e, 0xF7);
+    emit_modrm_rr(e, 0, reg);
+    emit32(e, imm);
+}
+
+// shl/shr/sar r32, imm8
+static void emit_shift_imm(Emitter *e, int ext, int reg, u8 amount) {
+    emit_rex(e, false, 0, reg);
+    emit8(e, 0xC1);
+    emit_modrm_rr(e, ext, reg);
+    emit8(e, amount);
+}
+
+// not/neg r32
+static void emit_unary(Emitter *e, int ext, int reg) {
+    emit_rex(e, false, 0, reg);
+    emit8(e, 0xF7);
+    emit_modrm_rr(e, ext, reg);
+}
+
+// imul dst, src
+static void emit_imul(Emitter *e, int dst, int src) {
+    emit_rex(e, false, dst, src);
+    emit8(e, 0x0F);
+    emit8(e, 0xAF);
+    emit_modrm_rr(e, dst, src);
+}
+
+// setcc dl; movzx edx, dl
+static void emit_setcc_edx(Emitter *e, int cc) {
+    emit8(e, 0x0F);
+    emit8(e, 0x90 + cc);
+    emit_modrm_rr(e, 0, RDX);
+    emit8(e, 0x0F);
+    emit8(e, 0xB6);
+    emit_modrm_rr(e, RDX, RDX);
+}
+
+// Jcc rel32 / JMP rel32, returning the rel32 field for patching
+static u8 *emit_jcc(Emitter *e, int cc) {
+    emit8(e, 0x0F);
+    emit8(e, 0x80 + cc);
+    u8 *site = e->p;
+    emit32(e, 0);
+    return site;
+}
+
+static u8 *emit_jmp(Emitter *e) {
+    emit8(e, 0xE9);
+    u8 *site = e->p;
+    emit32(e, 0);
+    return site;
+}
+
+static void patch_rel32(u8 *site, const u8 *target) {
+    s32 rel = (s32)(target - (site + 4));
+    memcpy(site, &rel, 4);
+}
+
+// add/sub rsp, imm8
+static void emit_stack_adjust(Emitter *e, int ext, u8 amount) {
+    emit8(e, 0x48);
+    emit8(e, 0x83);
+    emit_modrm_rr(e, ext, RSP);
+    emit8(e, amount);
+}
+
+static void emit_push(Emitter *e, int reg) {
+    emit_rex(e, false, 0, reg);
+    emit8(e, 0x50 + (reg & 7));
+}
+
+static void emit_pop(Emitter *e, int reg) {
+    emit_rex(e, false, 0, reg);
+    emit8(e, 0x58 + (reg & 7));
+}
+
+// ---------------------------------------------------------------------------
+// Guest helpers
+// ---------------------------------------------------------------------------
+
+// Load guest register n, where R15 reads as the pipelined value the
+// interpreter would see
+static void emit_read_reg(Emitter *e, int reg, u32 n, u32 r15) {
+    if (n == 15) emit_mov_imm32(e, reg, r15);
+    else emit_load32(e, reg, RBX, OFF_R(n));
+}
+
+// OR bit `bit` of CPSR (in ECX) from condition code cc
+static void emit_flag_bit(Emitter *e, int cc, u8 bit) {
+    emit_setcc_edx(e, cc);
+    emit_shift_imm(e, SHIFT_SHL, RDX, bit);
+    emit_alu(e, ALU_OR, RCX, RDX);
+}
+
+// N and Z from the result in EAX into ECX (CPSR), matching update_flags_logical
+static void emit_nz_bits(Emitter *e) {
+    emit_alu(e, ALU_MOV, RDX, RAX);
+    emit_alu_imm(e, EXT_AND, RDX, 0x80000000);
+    emit_alu(e, ALU_OR, RCX, RDX);
+    emit_alu(e, ALU_TEST, RAX, RAX);
+    emit_flag_bit(e, CC_E, 30);
+}
+
+static void emit_flags_logical(Emitter *e) {
+    emit_load32(e, RCX, RBX, OFF_CPSR);
+    emit_alu_imm(e, EXT_AND, RCX, 0x3FFFFFFF);
+    emit_nz_bits(e);
+    emit_store32(e, RBX, OFF_CPSR, RCX);
+}
+
+// a in R8D, b in R9D, result in EAX; matches update_flags_add
+static void emit_flags_add(Emitter *e) {
+    emit_load32(e, RCX, RBX, OFF_CPSR);
+    emit_alu_imm(e, EXT_AND, RCX, 0x0FFFFFFF);
+    emit_nz_bits(e);
+    // C = result < a
+    emit_alu(e, ALU_CMP, RAX, R8);
+    emit_flag_bit(e, CC_B, 29);
+    // V = ((a ^ result) & (b ^ result)) >> 31
+    emit_alu(e, ALU_MOV, RDX, R8);
+    emit_alu(e, ALU_XOR, RDX, RAX);
+    emit_alu(e, ALU_MOV, R10, R9);
+    emit_alu(e, ALU_XOR, R10, RAX);
+    emit_alu(e, ALU_AND, RDX, R10);
+    emit_shift_imm(e, SHIFT_SHR, RDX, 31);
+    emit_shift_imm(e, SHIFT_SHL, RDX, 28);
+    emit_alu(e, ALU_OR, RCX, RDX);
+    emit_store32(e, RBX, OFF_CPSR, RCX);
+}
+
+// a in R8D, b in R9D, result in EAX; matches update_flags_sub
+static void emit_flags_sub(Emitter *e) {
+    emit_load32(e, RCX, RBX, OFF_CPSR);
+    emit_alu_imm(e, EXT_AND, RCX, 0x0FFFFFFF);
+    emit_nz_bits(e);
+    // C = a >= b
+    emit_alu(e, ALU_CMP, R8, R9);
+    emit_flag_bit(e, CC_AE, 29);
+    // V = ((a ^ b) & (a ^ result)) >> 31
+    emit_alu(e, ALU_MOV, RDX, R8);
+    emit_alu(e, ALU_XOR, RDX, R9);
+    emit_alu(e, ALU_MOV, R10, R8);
+    emit_alu(e, ALU_XOR, R10, RAX);
+    emit_alu(e, ALU_AND, RDX, R10);
+    emit_shift_imm(e, SHIFT_SHR, RDX, 31);
+    emit_shift_imm(e, SHIFT_SHL, RDX, 28);
+    emit_alu(e, ALU_OR, RCX, RDX);
+    emit_store32(e, RBX, OFF_CPSR, RCX);
+}
+
+// EAX = R8D op R9D, then flags
+static void emit_add_sub(Emitter *e, bool subtract) {
+    emit_alu(e, ALU_MOV, RAX, R8);
+    emit_alu(e, subtract ? ALU_SUB : ALU_ADD, RAX, R9);
+    if (subtract) emit_flags_sub(e);
+    else emit_flags_add(e);
+}
+
+// ECX = 1 if the guest carry flag is set
+static void emit_load_carry(Emitter *e) {
+    emit_load32(e, RCX, RBX, OFF_CPSR);
+    emit_shift_imm(e, SHIFT_SHR, RCX, 29);
+    emit_alu_imm(e, EXT_AND, RCX, 1);
+}
+
+static void emit_add_cycles(Emitter *e, u32 *cycles) {
+    if (*cycles) {
+        emit_alu_imm(e, EXT_ADD, R13, *cycles);
+        *cycles = 0;
+    }
+}
+
+static void jit_sync_flags(ARM7TDMI *cpu) {
+    cpu_sync_flags(cpu);
+}
+
+// Call the interpreter handler for one opcode; its cycle count goes to R13D.
+// Handlers leave their flags pending (see cpu_sync_flags), while translated
+// code works on cpsr directly, so fold them in before going on.
+static void emit_call_handler(Emitter *e, u16 opcode, u32 r15) {
+    emit_store_imm32(e, RBX, OFF_R(15), r15);
+    emit_mov64(e, ARG0, RBX);
+    emit_mov64(e, ARG1, R12);
+    emit_mov_imm32(e, ARG2, opcode);
+    emit_mov_imm64(e, RAX, (u64)(uintptr_t)cpu_thumb_handler(opcode));
+    emit8(e, 0xFF);
+    emit8(e, 0xD0);  // call rax
+    emit_alu(e, ALU_ADD, R13, RAX);
+    
+    emit_load32(e, RCX, RBX, OFF_FLAG_OP);
+    emit_alu(e, ALU_TEST, RCX, RCX);
+    u8 *synced = emit_jcc(e, CC_E);
+    emit_mov64(e, ARG0, RBX);
+    emit_mov_imm64(e, RAX, (u64)(uintptr_t)jit_sync_flags);
+    emit8(e, 0xFF);
+    emit8(e, 0xD0);  // call rax
+    patch_rel32(synced, e->p);
+}
+
+// ---------------------------------------------------------------------------
+// Translation
+// ---------------------------------------------------------------------------
+
+static JitEntry *jit_find(JitState *jit, u32 pc) {
+    u32 i = (pc >> 1) & (JIT_MAP_SIZE - 1);
+    while (jit->map[i].pc && jit->map[i].pc != pc) {
+        i = (i + 1) & (JIT_MAP_SIZE - 1);
+    }
+    return &jit->map[i];
+}
+
+// Leave the block with R15 set for the next one. Jumps straight into the
+// next block when it is translated and neither the budget nor a pending
+// interrupt calls for a return to the frame loop.
+static void emit_chain_exit(JitState *jit, Emitter *e, u32 r15) {
+    emit_store_imm32(e, RBX, OFF_R(15), r15);
+    
+    emit_alu(e, ALU_CMP, R13, R14);
+    patch_rel32(emit_jcc(e, CC_AE), jit->exit_stub);
+    
+    // Same test as interrupt_check()
+    emit_load64(e, RAX, R12, OFF_INTS);
+    emit_test64(e, RAX);
+    u8 *no_ints = emit_jcc(e, CC_E);
+    emit_load16(e, RCX, RAX, OFF_IME);
+    emit_test_imm(e, RCX, 1);
+    u8 *disabled = emit_jcc(e, CC_E);
+    emit_load16(e, RCX, RAX, OFF_IE);
+    emit_load16(e, RDX, RAX, OFF_IF);
+    emit_alu(e, ALU_TEST, RCX, RDX);
+    patch_rel32(emit_jcc(e, CC_NE), jit->exit_stub);
+    patch_rel32(no_ints, e->p);
+    patch_rel32(disabled, e->p);
+    
+    u8 *site = emit_jmp(e);
+    u32 target = r15 - 4;
+    JitEntry *entry = jit_find(jit, target);
+    if (entry->pc == target) {
+        patch_rel32(site, entry->code);
+    } else {
+        patch_rel32(site, jit->exit_stub);
+        if (jit->patch_count < JIT_MAX_PATCHES) {
+            jit->patches[jit->patch_count].target_pc = target;
+            jit->patches[jit->patch_count].site = site;
+            jit->patch_count++;
+        }
+    }
+}
+
+// Conditional branch (format 16), mirroring thumb_cond_branch
+static void emit_cond_branch(JitState *jit, Emitter *e, u16 op, u32 r15, u32 *cycles) {
+    u32 cond = (op >> 8) & 0xF;
+    s32 offset = (s32)(s8)(op & 0xFF) * 2;
+    u32 taken_r15 = (((r15 - 2) + offset) & 0xFFFFFFFE) + 4;
+    
+    emit_add_cycles(e, cycles);
+    emit_load32(e, RCX, RBX, OFF_CPSR);
+    
+    int cc;
+    switch (cond) {
+        case 0x0: case 0x1:  // EQ/NE
+            emit_test_imm(e, RCX, FLAG_Z);
+            cc = (cond & 1) ? CC_E : CC_NE;
+            break;
+        case 0x2: case 0x3:  // CS/CC
+            emit_test_imm(e, RCX, FLAG_C);
+            cc = (cond & 1) ? CC_E : CC_NE;
+            break;
+        case 0x4: case 0x5:  // MI/PL
+            emit_test_imm(e, RCX, FLAG_N);
+            cc = (cond & 1) ? CC_E : CC_NE;
+            break;
+        case 0x6: case 0x7:  // VS/VC
+            emit_test_imm(e, RCX, FLAG_V);
+            cc = (cond & 1) ? CC_E : CC_NE;
+            break;
+        case 0x8: case 0x9:  // HI/LS: C set and Z clear
+            emit_alu(e, ALU_MOV, RAX, RCX);
+            emit_alu_imm(e, EXT_AND, RAX, FLAG_C | FLAG_Z);
+            emit_alu_imm(e, EXT_CMP, RAX, FLAG_C);
+            cc = (cond & 1) ? CC_NE : CC_E;
+            break;
+        case 0xA: case 0xB:  // GE/LT: N == V
+            emit_alu(e, ALU_MOV, RAX, RCX);
+            emit_shift_imm(e, SHIFT_SHR, RAX, 3);
+            emit_alu(e, ALU_XOR, RAX, RCX);
+            emit_test_imm(e, RAX, FLAG_V);
+            cc = (cond & 1) ? CC_NE : CC_E;
+            break;
+        default:             // GT/LE: Z clear and N == V
+            emit_alu(e, ALU_MOV, RAX, RCX);
+            emit_shift_imm(e, SHIFT_SHR, RAX, 3);
+            emit_alu(e, ALU_XOR, RAX, RCX);
+            emit_alu_imm(e, EXT_AND, RAX, FLAG_V);
+            emit_alu_imm(e, EXT_AND, RCX, FLAG_Z);
+            emit_alu(e, ALU_OR, RAX, RCX);
+            cc = (cond & 1) ? CC_NE : CC_E;
+            break;
+    }
+    u8 *taken = emit_jcc(e, cc);
+    
+    u32 not_taken_cycles = 1;
+    emit_add_cycles(e, &not_taken_cycles);
+    emit_chain_exit(jit, e, r15);
+    
+    patch_rel32(taken, e->p);
+    u32 taken_cycles = 3;
+    emit_add_cycles(e, &taken_cycles);
+    emit_chain_exit(jit, e, taken_r15);
+}
+
+// Format 4 ALU operations; returns false for the register shifts, which are
+// left to the interpreter
+static bool emit_alu_op(Emitter *e, u16 op, u32 *cycles) {
+    u32 rs = (op >> 3) & 0x7;
+    u32 rd = op & 0x7;
+    
+    switch ((op >> 6) & 0xF) {
+        case 0x0: case 0x1: case 0xC: case 0xE: case 0x8: {  // AND/EOR/ORR/BIC/TST
+            u32 alu = (op >> 6) & 0xF;
+            emit_load32(e, RAX, RBX, OFF_R(rd));
+            emit_load32(e, R9, RBX, OFF_R(rs));
+            if (alu == 0xE) emit_unary(e, 2, R9);  // not
+            emit_alu(e, alu == 0x1 ? ALU_XOR : (alu == 0xC ? ALU_OR : ALU_AND), RAX, R9);
+            if (alu != 0x8) emit_store32(e, RBX, OFF_R(rd), RAX);
+            emit_flags_logical(e);
+            break;
+        }
+        case 0x5:  // ADC
+        case 0x6:  // SBC
+            emit_load32(e, R8, RBX, OFF_R(rd));
+            emit_load32(e, R9, RBX, OFF_R(rs));
+            emit_load_carry(e);
+            emit_alu(e, ALU_MOV, RAX, R8);
+            if (((op >> 6) & 0xF) == 0x5) {
+                emit_alu(e, ALU_ADD, RAX, R9);
+                emit_alu(e, ALU_ADD, RAX, RCX);
+                emit_store32(e, RBX, OFF_R(rd), RAX);
+                emit_flags_add(e);
+            } else {
+                emit_alu(e, ALU_SUB, RAX, R9);
+                emit_alu_imm(e, EXT_XOR, RCX, 1);
+                emit_alu(e, ALU_SUB, RAX, RCX);
+                emit_store32(e, RBX, OFF_R(rd), RAX);
+                emit_flags_sub(e);
+            }
+            break;
+        case 0x9:  // NEG
+            emit_mov_imm32(e, R8, 0);
+            emit_load32(e, R9, RBX, OFF_R(rs));
+            emit_add_sub(e, true);
+            emit_store32(e, RBX, OFF_R(rd), RAX);
+            break;
+        case 0xA:  // CMP
+        case 0xB:  // CMN
+            emit_load32(e, R8, RBX, OFF_R(rd));
+            emit_load32(e, R9, RBX, OFF_R(rs));
+            emit_add_sub(e, ((op >> 6) & 0xF) == 0xA);
+            break;
+        case 0xD:  // MUL
+            emit_load32(e, RAX, RBX, OFF_R(rd));
+            emit_load32(e, R9, RBX, OFF_R(rs));
+            emit_imul(e, RAX, R9);
+            emit_store32(e, RBX, OFF_R(rd), RAX);
+            emit_flags_logical(e);
+            *cycles += 1;
+            break;
+        case 0xF:  // MVN
+            emit_load32(e, RAX, RBX, OFF_R(rs));
+            emit_unary(e, 2, RAX);
+            emit_store32(e, RBX, OFF_R(rd), RAX);
+            emit_flags_logical(e);
+            break;
+        default:   // LSL/LSR/ASR/ROR by register
+            return false;
+    }
+    *cycles += 1;
+    return true;
+}
+
+// Translate one non-branching instruction inline. Returns false if it has to
+// go through the interpreter handler.
+static bool emit_native(Emitter *e, u16 op, u32 r15, u32 *cycles) {
+    u32 rd = op & 0x7;
+    u32 rs = (op >> 3) & 0x7;
+    
+    switch (op >> 11) {
+        case 0x00: case 0x01: case 0x02: {  // Format 1: shift by immediate
+            u32 offset = (op >> 6) & 0x1F;
+            u32 type = op >> 11;
+            if (type == 1 && offset == 0) {
+                emit_mov_imm32(e, RAX, 0);
+            } else {
+                emit_load32(e, RAX, RBX, OFF_R(rs));
+                if (type == 0 && offset) emit_shift_imm(e, SHIFT_SHL, RAX, (u8)offset);
+                if (type == 1) emit_shift_imm(e, SHIFT_SHR, RAX, (u8)offset);
+                if (type == 2) emit_shift_imm(e, SHIFT_SAR, RAX, (u8)(offset ? offset : 31));
+            }
+            emit_store32(e, RBX, OFF_R(rd), RAX);
+            emit_flags_logical(e);
+            break;
+        }
+        case 0x03: {  // Format 2: add/subtract
+            u32 rn_imm = (op >> 6) & 0x7;
+            emit_load32(e, R8, RBX, OFF_R(rs));
+            if (op & (1 << 10)) emit_mov_imm32(e, R9, rn_imm);
+            else emit_load32(e, R9, RBX, OFF_R(rn_imm));
+            emit_add_sub(e, (op & (1 << 9)) != 0);
+            emit_store32(e, RBX, OFF_R(rd), RAX);
+            break;
+        }
+        case 0x04: case 0x05: case 0x06: case 0x07: {  // Format 3: immediate
+            u32 rd8 = (op >> 8) & 0x7;
+            u32 imm = op & 0xFF;
+            if ((op >> 11) == 0x04) {  // MOV
+                emit_mov_imm32(e, RAX, imm);
+                emit_store32(e, RBX, OFF_R(rd8), RAX);
+                emit_flags_logical(e);
+            } else {
+                emit_load32(e, R8, RBX, OFF_R(rd8));
+                emit_mov_imm32(e, R9, imm);
+                emit_add_sub(e, (op >> 11) != 0x06);
+                if ((op >> 11) != 0x05) emit_store32(e, RBX, OFF_R(rd8), RAX);  // not CMP
+            }
+            break;
+        }
+        case 0x08:
+            if ((op >> 10) == 0x10) {
+                return emit_alu_op(e, op, cycles);
+            } else {
+                // Format 5 without PC as destination (those end the block)
+                u32 hs = rs | ((op >> 3) & 0x8);
+                u32 hd = rd | ((op >> 4) & 0x8);
+                switch ((op >> 8) & 0x3) {
+                    case 0:  // ADD
+                        emit_read_reg(e, RAX, hd, r15);
+                        emit_read_reg(e, R9, hs, r15);
+                        emit_alu(e, ALU_ADD, RAX, R9);
+                        emit_store32(e, RBX, OFF_R(hd), RAX);
+                        break;
+                    case 1:  // CMP
+                        emit_read_reg(e, R8, hd, r15);
+                        emit_read_reg(e, R9, hs, r15);
+                        emit_add_sub(e, true);
+                        break;
+                    case 2:  // MOV
+                        emit_read_reg(e, RAX, hs, r15);
+                        emit_store32(e, RBX, OFF_R(hd), RAX);
+                        break;
+                    default:
+                        return false;
+                }
+            }
+            break;
+        case 0x14:  // Format 12: ADD rd, PC, #imm
+            emit_mov_imm32(e, RAX, ((r15 - 2) & ~3u) + (op & 0xFF) * 4);
+            emit_store32(e, RBX, OFF_R((op >> 8) & 0x7), RAX);
+            break;
+        case 0x15:  // Format 12: ADD rd, SP, #imm
+            emit_load32(e, RAX, RBX, OFF_R(13));
+            emit_alu_imm(e, EXT_ADD, RAX, (op & 0xFF) * 4);
+            emit_store32(e, RBX, OFF_R((op >> 8) & 0x7), RAX);
+            break;
+        case 0x16:  // Format 13: ADD/SUB SP, #imm
+            if ((op & 0xFF00) != 0xB000) return false;
+            emit_load32(e, RAX, RBX, OFF_R(13));
+            emit_alu_imm(e, (op & (1 << 7)) ? EXT_SUB : EXT_ADD, RAX, (op & 0x7F) * 4);
+            emit_store32(e, RBX, OFF_R(13), RAX);
+            break;
+        default:
+            return false;
+    }
+    *cycles += 1;
+    return true;
+}
+
+static u8 *jit_compile(JitState *jit, Memory *mem, u32 pc) {
+    if (jit->code_used + JIT_BLOCK_MAX_BYTES > JIT_CODE_SIZE ||
+        jit->map_count >= JIT_MAP_SIZE / 4 * 3) {
+        jit_flush(jit);
+    }
+    
+    Emitter e = { jit->code + jit->code_used };
+    u8 *start = e.p;
+    u32 addr = pc;
+    u32 cycles = 0;
+    bool ended = false;
+    
+    // Same boundaries as the interpreter's block cache
+    for (u32 n = 0; n < BLOCK_MAX_INSTRS && !ended; n++) {
+        u16 op = mem_read16(mem, addr);
+        u32 r15 = addr + 6;  // R15 while this instruction executes
+        
+        if (cpu_thumb_ends_block(op)) {
+            if ((op >> 12) == 0xD && ((op >> 8) & 0xF) < 0xE) {
+                emit_cond_branch(jit, &e, op, r15, &cycles);
+            } else if ((op >> 11) == 0x1C) {
+                s32 offset = (s32)((u32)(op & 0x7FF) << 21) >> 20;
+                cycles += 3;
+                emit_add_cycles(&e, &cycles);
+                emit_chain_exit(jit, &e, (r15 + offset) & 0xFFFFFFFE);
+            } else {
+                // BL, BX, POP {PC}, hi-register writes to PC, SWI:
+                // run the handler and return to the frame loop
+                emit_add_cycles(&e, &cycles);
+                emit_call_handler(&e, op, r15);
+                patch_rel32(emit_jmp(&e), jit->exit_stub);
+            }
+            ended = true;
+        } else if (!emit_native(&e, op, r15, &cycles)) {
+            emit_call_handler(&e, op, r15);
+        }
+        addr += 2;
+    }
+    
+    if (!ended) {
+        // Length limit reached: continue with the next block
+        emit_add_cycles(&e, &cycles);
+        emit_chain_exit(jit, &e, addr + 4);
+    }
+    
+    jit->code_used = (u32)(e.p - jit->code);
+    
+    JitEntry *entry = jit_find(jit, pc);
+    entry->pc = pc;
+    entry->code = start;
+    jit->map_count++;
+    
+    // Link jumps that were waiting for this block
+    for (u32 i = 0; i < jit->patch_count; ) {
+        if (jit->patches[i].target_pc == pc) {
+            patch_rel32(jit->patches[i].site, start);
+            jit->patches[i] = jit->patches[--jit->patch_count];
+        } else {
+            i++;
+        }
+    }
+    
+    return start;
+}
+
+// Entry trampoline and shared exit stub
+static void jit_emit_runtime(JitState *jit) {
+    Emitter e = { jit->code };
+    
+    // u32 enter(ARM7TDMI *cpu, Memory *mem, void *code, u32 budget)
+    jit->enter = (JitEnterFn)(uintptr_t)e.p;
+    emit_push(&e, RBX);
+    emit_push(&e, R12);
+    emit_push(&e, R13);
+    emit_push(&e, R14);
+    emit_stack_adjust(&e, EXT_SUB, 40);  // 16-byte alignment + Win64 shadow space
+    emit_mov64(&e, RBX, ARG0);
+    emit_mov64(&e, R12, ARG1);
+    emit_alu(&e, ALU_XOR, R13, R13);
+    emit_alu(&e, ALU_MOV, R14, ARG3);
+    emit_rex(&e, false, 0, ARG2);
+    emit8(&e, 0xFF);
+    emit_modrm_rr(&e, 4, ARG2);  // jmp ARG2
+    
+    jit->exit_stub = e.p;
+    emit_alu(&e, ALU_MOV, RAX, R13);
+    emit_stack_adjust(&e, EXT_ADD, 40);
+    emit_pop(&e, R14);
+    emit_pop(&e, R13);
+    emit_pop(&e, R12);
+    emit_pop(&e, RBX);
+    emit8(&e, 0xC3);  // ret
+    
+    jit->code_base = (u32)(e.p - jit->code);
+    jit->code_used = jit->code_base;
+}
+
+JitState *jit_create(void) {
+    JitState *jit = (JitState*)calloc(1, sizeof(JitState));
+    if (!jit) return NULL;
+
+#ifdef _WIN32
+    jit->code = (u8*)VirtualAlloc(NULL, JIT_CODE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+    void *code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    jit->code = (code == MAP_FAILED) ? NULL : (u8*)code;
+#endif
+    if (!jit->code) {
+        free(jit);
+        return NULL;
+    }
+    
+    jit_emit_runtime(jit);
+    return jit;
+}
+
+void jit_destroy(JitState *jit) {
+    if (!jit) return;
+
+#ifdef _WIN32
+    VirtualFree(jit->code, 0, MEM_RELEASE);
+#else
+    munmap(jit->code, JIT_CODE_SIZE);
+#endif
+    free(jit);
+}
+
+void jit_flush(JitState *jit) {
+    if (!jit) return;
+    
+    memset(jit->map, 0, sizeof(jit->map));
+    jit->map_count = 0;
+    jit->patch_count = 0;
+    jit->code_used = jit->code_base;
+}
+
+u32 jit_run(JitState *jit, ARM7TDMI *cpu, Memory *mem, u32 budget) {
+    if (!jit || !cpu->thumb_mode) return 0;
+    
+    // Only Thumb code in ROM is translated. The header area is left to the
+    // interpreter: reads of 0x080000C4-0x080000C9 return GPIO registers.
+    u32 pc = cpu->r[15] - 4;
+    if (pc < 0x08000100 || pc >= 0x0E000000) return 0;
+    
+    JitEntry *entry = jit_find(jit, pc);
+    u8 *code = (entry->pc == pc) ? entry->code : jit_compile(jit, mem, pc);
+    
+    // Translated code reads and writes NZCV in cpsr
+    cpu_sync_flags(cpu);
+    return jit->enter(cpu, mem, code, budget);
+}
+
+#else // !JIT_X64_AVAILABLE
+
+JitState *jit_create(void) {
+    return NULL;
+}
+
+void jit_destroy(JitState *jit) {
+    (void)jit;
+}
+
+void jit_flush(JitState *jit) {
+    (void)jit;
+}
+
+u32 jit_run(JitState *jit, ARM7TDMI *cpu, Memory *mem, u32 budget) {
+    (void)jit; (void)cpu; (void)mem; (void)budget;
+    return 0;
+}
+
+#endif // JIT_X64_AVAILABLE
@@ -0,0 +1,39 @@
+#ifndef JIT_X64_H
+#define JIT_X64_H
+
+#include "types.h"
+#include "cpu_core.h"
+
+// Experimental x86-64 dynamic recompiler for Thumb code in ROM
+//
+// Translates the same basic blocks the interpreter's block cache would build,
+// starting at 0x08000000+, into native code. Guest registers stay in the
+// ARM7TDMI struct. ALU/shift/immediate/hi-register instructions are emitted
+// inline; loads, stores and everything else call the interpreter's handler
+// for that opcode. Direct branches are chained block-to-block and hand
+// control back when the cycle budget runs out or an interrupt is pending.
+//
+// On hosts other than x86-64, jit_create() returns NULL and the interpreter
+// is used unchanged.
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_X64_AVAILABLE 1
+#else
+#define JIT_X64_AVAILABLE 0
+#endif
+
+typedef struct JitState JitState;
+
+// Create/destroy a recompiler (returns NULL if unsupported or out of memory)
+JitState *jit_create(void);
+void jit_destroy(JitState *jit);
+
+// Drop all translated code
+void jit_flush(JitState *jit);
+
+// Run translated code at the current PC until the budget is spent, an
+// interrupt is pending, or control leaves chained code.
+// Returns cycles executed, or 0 if the interpreter must handle this PC.
+u32 jit_run(JitState *jit, ARM7TDMI *cpu, Memory *mem, u32 budget);
+
+#endif // JIT_X64_H
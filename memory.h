@@ -1,55 +1,194 @@
-#ifndef MEMORY_H
-#define MEMORY_H
-
-#include "types.h"
-
-// Forward declaration
-typedef struct InterruptState InterruptState;
-typedef struct TimerState TimerState;
-typedef struct DMAState DMAState;
-typedef struct RTCState RTCState;
-
-typedef struct Memory_s {
-    u8 *rom;              // ROM data (loaded from file)
-    u32 rom_size;         // Actual ROM size
-    u8 ewram[EWRAM_SIZE]; // External WRAM (256KB)
-    u8 iwram[IWRAM_SIZE]; // Internal WRAM (32KB)
-    u8 vram[VRAM_SIZE];   // Video RAM (96KB)
-    u8 oam[OAM_SIZE];     // Object Attribute Memory (1KB)
-    u8 palette[PALETTE_SIZE]; // Palette RAM (1KB)
-    u8 io_regs[IO_SIZE];  // I/O Registers (1KB)
-    u8 sram[0x20000];     // Save RAM / Flash (128KB for Pokemon Emerald)
-    u16 gpio_data;        // GPIO data register
-    u16 gpio_direction;   // GPIO direction register (1=output, 0=input)
-    u16 gpio_control;     // GPIO control register
-    u8 flash_state;       // Flash command state (0=normal, 1=cmd mode)
-    u8 flash_cmd;         // Last flash command
-    InterruptState *interrupts; // Pointer to interrupt state
-    TimerState *timers;   // Pointer to timer state
-    DMAState *dma;        // Pointer to DMA state
-    RTCState *rtc;        // Pointer to RTC state
-} Memory;
-
-// Initialize memory subsystem
-void mem_init(Memory *mem);
-void mem_cleanup(Memory *mem);
-void mem_set_rom(Memory *mem, u8 *rom, u32 size);
-void mem_set_interrupts(Memory *mem, InterruptState *interrupts);
-void mem_set_timers(Memory *mem, TimerState *timers);
-void mem_set_dma(Memory *mem, DMAState *dma);
-void mem_set_rtc(Memory *mem, RTCState *rtc);
-
-// Memory access functions
-u32 mem_read32(Memory *mem, u32 addr);
-u16 mem_read16(Memory *mem, u32 addr);
-u8  mem_read8(Memory *mem, u32 addr);
-
-void mem_write32(Memory *mem, u32 addr, u32 value);
-void mem_write16(Memory *mem, u32 addr, u16 value);
-void mem_write8(Memory *mem, u32 addr, u8 value);
-
-// Helper to get AI input state
-u8 mem_get_ai_input(Memory *mem);
-void mem_set_ai_input(Memory *mem, u8 value);
-
-#endif // MEMORY_H
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include "types.h"
+#include "bios.h"
+
+// Forward declaration
+typedef struct InterruptState InterruptState;
+typedef struct TimerState TimerState;
+typedef struct DMAState DMAState;
+typedef struct RTCState RTCState;
+typedef struct BlockCache BlockCache;
+typedef struct JitState JitState;
+typedef struct AotProgram AotProgram;
+typedef struct Scheduler Scheduler;
+typedef struct CpuHost CpuHost;
+
+// Memory map
+//
+// Address bits 31-24 select one of 256 regions. Plain memory (EWRAM, IWRAM,
+// palette, VRAM, OAM, ROM) is accessed straight through a host pointer:
+// offset = addr & mask hits base[offset] if first <= offset < first + size.
+// Anything outside that window, and regions without a base (BIOS, I/O,
+// GPIO, Flash, unmapped), goes through the slow-path handlers in memory.c.
+#define MEM_REGION_SHIFT  24
+#define MEM_REGION_COUNT  256
+
+typedef enum MemCode {
+    MEM_CODE_NONE,        // Writes can't touch cached code
+    MEM_CODE_EWRAM,       // Writes invalidate cached EWRAM blocks
+    MEM_CODE_IWRAM        // Writes invalidate cached IWRAM blocks
+} MemCode;
+
+typedef struct MemRegion {
+    u8 *base;             // Host address of offset 0, NULL = slow path only
+    u32 mask;             // Mirroring mask applied to the address
+    u32 first;            // Directly mapped offsets: [first, first + size)
+    u32 size;
+    u32 code;             // MemCode (write map only)
+    u32 page;             // Dirty page of offset 0 (write map only)
+} MemRegion;
+
+// Dirty pages
+//
+// The guest bytes at the start of Memory are split into 256-byte pages,
+// numbered by their offset in Memory (page p = bytes [p * 256, p * 256 + 256)).
+// Every store to EWRAM, IWRAM, VRAM, OAM, palette RAM or flash sets the bit
+// of its page, so snapshots, hashes and caches can skip what didn't change.
+// I/O registers and the GPIO/flash command fields are not tracked;
+// mem_dirty_bits() always reports their pages.
+//
+// Each consumer reads and clears the bits through its own channel: clearing
+// one channel keeps the pending bits for the others.
+#define MEM_PAGE_SHIFT  8
+#define MEM_PAGE_SIZE   (1u << MEM_PAGE_SHIFT)
+
+typedef enum MemDirtyChannel {
+    MEM_DIRTY_USER,       // emu_get_dirty_pages / emu_clear_dirty
+    MEM_DIRTY_FORK,       // Writes since this instance last forked (emu_fork)
+    MEM_DIRTY_SYNC,       // Writes since a fork was synced from its parent
+    MEM_DIRTY_GFX,        // Video memory the renderer's caches haven't seen
+    MEM_DIRTY_CHANNELS
+} MemDirtyChannel;
+
+typedef enum MemArea {
+    MEM_AREA_EWRAM,
+    MEM_AREA_IWRAM,
+    MEM_AREA_VRAM,
+    MEM_AREA_OAM,
+    MEM_AREA_PALETTE,
+    MEM_AREA_SRAM,
+    MEM_AREA_COUNT
+} MemArea;
+
+// Rate limits and last-seen values for the diagnostic printfs in memory.c
+// and the devices it drives (DMA, RTC), and other host-side counters. Kept
+// per instance so emulators running on different threads never touch
+// shared counters.
+typedef struct MemDebug {
+    u32 warnings;             // Unmapped-access warnings printed so far
+    u32 keyinput_reads;
+    u32 gpio_reads[6];        // Per GPIO register byte (0x080000C4-C9)
+    u32 gpio_writes[6];
+    u32 flash_cmds;
+    u32 save_probes;
+    u16 last_dispcnt;
+    u16 last_dispstat;
+    bool dispcnt_logged;
+    u8 io_read_seen[IO_SIZE / 8];  // One bit per I/O register byte
+    u8 io_write_seen[IO_SIZE / 8];
+    u32 dma_logs;             // DMA transfers logged by dma.c
+    u8 rtc_cs_rise_logs;      // RTC protocol events logged by rtc.c
+    u8 rtc_cs_fall_logs;
+    u8 rtc_command_logs;
+    u8 rtc_time_logs;
+    u32 timer_reads;          // Timer counter reads so far (idle-loop detection)
+} MemDebug;
+
+// Pages covering Memory's guest bytes (offsetof(Memory, rom), asserted in memory.c)
+#define MEM_PAGE_COUNT  ((EWRAM_SIZE + IWRAM_SIZE + VRAM_SIZE + OAM_SIZE + PALETTE_SIZE + \
+                          IO_SIZE + 0x20000) / MEM_PAGE_SIZE + 1)
+#define MEM_DIRTY_WORDS ((MEM_PAGE_COUNT + 63) / 64)
+
+typedef struct Memory_s {
+    // Guest state. Kept first and free of pointers so a GuestState snapshot
+    // can copy it as plain bytes (see MEM_GUEST_BYTES).
+    u8 ewram[EWRAM_SIZE]; // External WRAM (256KB)
+    u8 iwram[IWRAM_SIZE]; // Internal WRAM (32KB)
+    u8 vram[VRAM_SIZE];   // Video RAM (96KB)
+    u8 oam[OAM_SIZE];     // Object Attribute Memory (1KB)
+    u8 palette[PALETTE_SIZE]; // Palette RAM (1KB)
+    u8 io_regs[IO_SIZE];  // I/O Registers (1KB)
+    u8 sram[0x20000];     // Save RAM / Flash (128KB for Pokemon Emerald)
+    u16 gpio_data;        // GPIO data register
+    u16 gpio_direction;   // GPIO direction register (1=output, 0=input)
+    u16 gpio_control;     // GPIO control register
+    u8 flash_state;       // Flash command state (0=normal, 1=cmd mode)
+    u8 flash_cmd;         // Last flash command
+    
+    // Host side: ROM, links to the other components, lookup tables
+    u8 *rom;              // ROM data (loaded from file)
+    u32 rom_size;         // Actual ROM size
+    u8 bios[BIOS_SIZE];   // HLE BIOS image (vectors, IRQ dispatcher)
+    InterruptState *interrupts; // Pointer to interrupt state
+    TimerState *timers;   // Pointer to timer state
+    DMAState *dma;        // Pointer to DMA state
+    RTCState *rtc;        // Pointer to RTC state
+    BlockCache *block_cache; // Pointer to interpreter block cache (optional)
+    JitState *jit;        // Pointer to Thumb recompiler (optional, experimental)
+    const AotProgram *aot; // Ahead-of-time translated ROM code (optional)
+    Scheduler *scheduler; // Event scheduler (owns the current cycle stamp)
+    CpuHost *cpu_host;    // CPU diagnostics (log state, instruction trace)
+    MemRegion read_map[MEM_REGION_COUNT];  // Fast paths for loads
+    MemRegion write_map[MEM_REGION_COUNT]; // Fast paths for stores
+    u64 dirty[MEM_DIRTY_WORDS]; // One bit per page written since any channel was cleared
+    u64 dirty_pending[MEM_DIRTY_CHANNELS][MEM_DIRTY_WORDS]; // Bits set before another channel's clear
+    MemDebug debug;       // Diagnostic log state and host-side counters
+} Memory;
+
+// Bytes at the start of Memory that hold guest state
+#define MEM_GUEST_BYTES offsetof(Memory, rom)
+
+// Initialize memory subsystem
+void mem_init(Memory *mem);
+void mem_cleanup(Memory *mem);
+void mem_set_rom(Memory *mem, u8 *rom, u32 size);
+void mem_set_interrupts(Memory *mem, InterruptState *interrupts);
+void mem_set_timers(Memory *mem, TimerState *timers);
+void mem_set_dma(Memory *mem, DMAState *dma);
+void mem_set_rtc(Memory *mem, RTCState *rtc);
+void mem_set_block_cache(Memory *mem, BlockCache *cache);
+void mem_set_jit(Memory *mem, JitState *jit);
+void mem_set_aot(Memory *mem, const AotProgram *aot);
+void mem_set_scheduler(Memory *mem, Scheduler *scheduler);
+void mem_set_cpu_host(Memory *mem, CpuHost *host);
+
+// Rebuild read_map/write_map (done by mem_init and mem_set_rom; needed again
+// if the Memory struct is moved or copied, as the maps point into it)
+void mem_map_regions(Memory *mem);
+
+// Dirty page tracking (see MemArea)
+void mem_clear_dirty(Memory *mem, MemDirtyChannel channel);
+void mem_mark_all_dirty(Memory *mem);
+void mem_dirty_bits(const Memory *mem, MemDirtyChannel channel, u64 *bits); // MEM_DIRTY_WORDS words
+void mem_area_pages(MemArea area, u32 *first, u32 *count);  // Page range of an area
+u8 *mem_page_ptr(Memory *mem, u32 page);                     // Host address of a page
+
+// Copy the guest bytes of the pages set in 'pages' from src to dst and drop
+// dst's cached code on them. dst's dirty bits are left alone.
+void mem_copy_pages(Memory *dst, const Memory *src, const u64 *pages);
+
+static inline bool mem_page_dirty(const Memory *mem, MemDirtyChannel channel, u32 page) {
+    u64 bits = mem->dirty[page >> 6] | mem->dirty_pending[channel][page >> 6];
+    return (bits >> (page & 63)) & 1;
+}
+
+static inline void mem_mark_dirty(Memory *mem, u32 page) {
+    mem->dirty[page >> 6] |= (u64)1 << (page & 63);
+}
+
+// Memory access functions
+u32 mem_read32(Memory *mem, u32 addr);
+u16 mem_read16(Memory *mem, u32 addr);
+u8  mem_read8(Memory *mem, u32 addr);
+
+void mem_write32(Memory *mem, u32 addr, u32 value);
+void mem_write16(Memory *mem, u32 addr, u16 value);
+void mem_write8(Memory *mem, u32 addr, u8 value);
+
+// Helper to get AI input state
+u8 mem_get_ai_input(Memory *mem);
+void mem_set_ai_input(Memory *mem, u8 value);
+
+#endif // MEMORY_H
@@ -0,0 +1,363 @@
+#include "page_store.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE_CHUNK 256          // Pages per data allocation
+#define NONE       0xFFFFFFFFu  // No page / no state
+
+typedef struct StoredPage {
+    u64 hash;
+    u32 refs;             // States holding the page (0 = on the free list)
+    u32 next_free;
+} StoredPage;
+
+typedef struct StoredState {
+    u32 *pages;           // Page numbers (NULL = free slot)
+    u32 generation;       // Part of the id, bumped when the slot is freed
+    u32 older, newer;     // LRU list
+    u32 next_free;
+} StoredState;
+
+struct PageStore {
+    u32 state_size;
+    u32 page_size;
+    u32 pages_per_state;
+    u64 max_bytes;
+    u8 *tail;             // Zero-padded copy of a partial last page
+    
+    // Unique pages: records, data in PAGE_CHUNK-page blocks
+    StoredPage *pages;
+    u8 **chunks;
+    u32 page_count;       // Records in use or on the free list
+    u32 page_capacity;
+    u32 free_page;
+    u32 unique;           // Pages with refs > 0
+    
+    // Open-addressed hash index: page number + 1, 0 = empty slot
+    u32 *table;
+    u32 table_mask;
+    
+    // States
+    StoredState *states;
+    u32 state_count;
+    u32 state_capacity;
+    u32 free_state;
+    u32 live;
+    u32 oldest, newest;
+};
+
+// Hashing
+
+static u64 mix64(u64 h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Four independent lanes so the multiplies overlap
+static u64 page_hash(const u8 *data, u32 size) {
+    u64 lane[4] = { 1, 2, 3, 4 };
+    for (u32 i = 0; i < size; i += 32) {
+        for (u32 l = 0; l < 4; l++) {
+            u64 word;
+            memcpy(&word, data + i + l * 8, sizeof(word));
+            lane[l] = (lane[l] ^ word) * 0x9E3779B97F4A7C15ull;
+            lane[l] ^= lane[l] >> 29;
+        }
+    }
+    return mix64(lane[0] ^ mix64(lane[1] ^ mix64(lane[2] ^ mix64(lane[3]))));
+}
+
+// Pages
+
+static u8 *page_data(const PageStore *store, u32 page) {
+    return store->chunks[page / PAGE_CHUNK] + (size_t)(page % PAGE_CHUNK) * store->page_size;
+}
+
+static u32 page_alloc(PageStore *store) {
+    if (store->free_page != NONE) {
+        u32 page = store->free_page;
+        store->free_page = store->pages[page].next_free;
+        return page;
+    }
+    
+    if (store->page_count == store->page_capacity) {
+        u32 capacity = store->page_capacity ? store->page_capacity * 2 : PAGE_CHUNK;
+        StoredPage *pages = (StoredPage*)realloc(store->pages, capacity * sizeof(StoredPage));
+        if (!pages) return NONE;
+        store->pages = pages;
+        u8 **chunks = (u8**)realloc(store->chunks, (capacity / PAGE_CHUNK) * sizeof(u8*));
+        if (!chunks) return NONE;
+        store->chunks = chunks;
+        store->page_capacity = capacity;
+    }
+    if (store->page_count % PAGE_CHUNK == 0) {
+        u8 *chunk = (u8*)malloc((size_t)PAGE_CHUNK * store->page_size);
+        if (!chunk) return NONE;
+        store->chunks[store->page_count / PAGE_CHUNK] = chunk;
+    }
+    return store->page_count++;
+}
+
+static bool table_grow(PageStore *store) {
+    u32 size = (store->table_mask + 1) * 2;
+    u32 *table = (u32*)calloc(size, sizeof(u32));
+    if (!table) return false;
+    
+    for (u32 i = 0; i <= store->table_mask; i++) {
+        u32 entry = store->table[i];
+        if (!entry) continue;
+        u32 slot = (u32)store->pages[entry - 1].hash & (size - 1);
+        while (table[slot]) slot = (slot + 1) & (size - 1);
+        table[slot] = entry;
+    }
+    free(store->table);
+    store->table = table;
+    store->table_mask = size - 1;
+    return true;
+}
+
+// Page number holding these bytes, adding it if new (one more reference)
+static u32 page_intern(PageStore *store, const u8 *data) {
+    u64 hash = page_hash(data, store->page_size);
+    u32 slot = (u32)hash & store->table_mask;
+    
+    for (; store->table[slot]; slot = (slot + 1) & store->table_mask) {
+        u32 page = store->table[slot] - 1;
+        if (store->pages[page].hash == hash &&
+            memcmp(page_data(store, page), data, store->page_size) == 0) {
+            store->pages[page].refs++;
+            return page;
+        }
+    }
+    
+    u32 page = page_alloc(store);
+    if (page == NONE) return NONE;
+    memcpy(page_data(store, page), data, store->page_size);
+    store->pages[page].hash = hash;
+    store->pages[page].refs = 1;
+    store->table[slot] = page + 1;
+    store->unique++;
+    
+    // Keep the index at most half full (a failed grow only makes probes longer)
+    if (store->unique * 2 > store->table_mask + 1) table_grow(store);
+    return page;
+}
+
+// Drop one reference; the last one frees the page
+static void page_release(PageStore *store, u32 page) {
+    if (--store->pages[page].refs) return;
+    
+    // Linear probing: pull later entries of the cluster back into the hole
+    u32 mask = store->table_mask;
+    u32 hole = (u32)store->pages[page].hash & mask;
+    while (store->table[hole] != page + 1) hole = (hole + 1) & mask;
+    for (u32 next = (hole + 1) & mask; store->table[next]; next = (next + 1) & mask) {
+        u32 home = (u32)store->pages[store->table[next] - 1].hash & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            store->table[hole] = store->table[next];
+            hole = next;
+        }
+    }
+    store->table[hole] = 0;
+    
+    store->pages[page].next_free = store->free_page;
+    store->free_page = page;
+    store->unique--;
+}
+
+// States
+
+static void lru_unlink(PageStore *store, u32 slot) {
+    StoredState *state = &store->states[slot];
+    if (state->older != NONE) store->states[state->older].newer = state->newer;
+    else store->oldest = state->newer;
+    if (state->newer != NONE) store->states[state->newer].older = state->older;
+    else store->newest = state->older;
+}
+
+static void lru_push(PageStore *store, u32 slot) {
+    StoredState *state = &store->states[slot];
+    state->older = store->newest;
+    state->newer = NONE;
+    if (store->newest != NONE) store->states[store->newest].newer = slot;
+    else store->oldest = slot;
+    store->newest = slot;
+}
+
+static u32 state_alloc(PageStore *store) {
+    if (store->free_state != NONE) {
+        u32 slot = store->free_state;
+        store->free_state = store->states[slot].next_free;
+        return slot;
+    }
+    
+    if (store->state_count == store->state_capacity) {
+        u32 capacity = store->state_capacity ? store->state_capacity * 2 : 64;
+        StoredState *states = (StoredState*)realloc(store->states, capacity * sizeof(StoredState));
+        if (!states) return NONE;
+        store->states = states;
+        store->state_capacity = capacity;
+    }
+    store->states[store->state_count].generation = 1;
+    return store->state_count++;
+}
+
+static void state_free(PageStore *store, u32 slot) {
+    StoredState *state = &store->states[slot];
+    state->pages = NULL;
+    if (++state->generation == 0) state->generation = 1;
+    state->next_free = store->free_state;
+    store->free_state = slot;
+}
+
+static u64 state_id(const PageStore *store, u32 slot) {
+    return ((u64)store->states[slot].generation << 32) | slot;
+}
+
+static u32 state_slot(const PageStore *store, u64 id) {
+    u32 slot = (u32)id;
+    if (slot >= store->state_count) return NONE;
+    const StoredState *state = &store->states[slot];
+    if (!state->pages || state->generation != (u32)(id >> 32)) return NONE;
+    return slot;
+}
+
+static void state_drop(PageStore *store, u32 slot) {
+    StoredState *state = &store->states[slot];
+    for (u32 i = 0; i < store->pages_per_state; i++) {
+        page_release(store, state->pages[i]);
+    }
+    free(state->pages);
+    lru_unlink(store, slot);
+    state_free(store, slot);
+    store->live--;
+}
+
+// Public API
+
+PageStore *page_store_create(u32 state_size, u32 page_size, u64 max_bytes) {
+    if (state_size == 0 || page_size < 32 || (page_size & (page_size - 1))) return NULL;
+    
+    PageStore *store = (PageStore*)calloc(1, sizeof(PageStore));
+    if (!store) return NULL;
+    
+    store->state_size = state_size;
+    store->page_size = page_size;
+    store->pages_per_state = (state_size + page_size - 1) / page_size;
+    store->max_bytes = max_bytes;
+    store->free_page = NONE;
+    store->free_state = NONE;
+    store->oldest = NONE;
+    store->newest = NONE;
+    store->tail = (u8*)calloc(1, page_size);
+    store->table_mask = 1023;
+    store->table = (u32*)calloc(store->table_mask + 1, sizeof(u32));
+    if (!store->tail || !store->table) {
+        page_store_destroy(store);
+        return NULL;
+    }
+    return store;
+}
+
+void page_store_destroy(PageStore *store) {
+    if (!store) return;
+    
+    for (u32 i = 0; i < store->state_count; i++) {
+        free(store->states[i].pages);
+    }
+    for (u32 i = 0; i < (store->page_count + PAGE_CHUNK - 1) / PAGE_CHUNK; i++) {
+        free(store->chunks[i]);
+    }
+    free(store->states);
+    free(store->chunks);
+    free(store->pages);
+    free(store->table);
+    free(store->tail);
+    free(store);
+}
+
+u64 page_store_put(PageStore *store, const u8 *state) {
+    if (!store || !state) return 0;
+    
+    u32 slot = state_alloc(store);
+    if (slot == NONE) return 0;
+    u32 *pages = (u32*)malloc(store->pages_per_state * sizeof(u32));
+    if (!pages) {
+        state_free(store, slot);
+        return 0;
+    }
+    
+    for (u32 i = 0; i < store->pages_per_state; i++) {
+        const u8 *data = state + (size_t)i * store->page_size;
+        u32 left = store->state_size - i * store->page_size;
+        if (left < store->page_size) {
+            memset(store->tail, 0, store->page_size);
+            memcpy(store->tail, data, left);
+            data = store->tail;
+        }
+        
+        pages[i] = page_intern(store, data);
+        if (pages[i] == NONE) {
+            while (i--) page_release(store, pages[i]);
+            free(pages);
+            state_free(store, slot);
+            return 0;
+        }
+    }
+    
+    store->states[slot].pages = pages;
+    lru_push(store, slot);
+    store->live++;
+    
+    // Stay under the budget, but always keep the state just added
+    while (store->max_bytes && page_store_bytes(store) > store->max_bytes &&
+           store->oldest != slot) {
+        state_drop(store, store->oldest);
+    }
+    return state_id(store, slot);
+}
+
+bool page_store_get(PageStore *store, u64 id, u8 *out) {
+    if (!store || !out) return false;
+    
+    u32 slot = state_slot(store, id);
+    if (slot == NONE) return false;
+    
+    const u32 *pages = store->states[slot].pages;
+    for (u32 i = 0; i < store->pages_per_state; i++) {
+        u32 left = store->state_size - i * store->page_size;
+        memcpy(out + (size_t)i * store->page_size, page_data(store, pages[i]),
+               left < store->page_size ? left : store->page_size);
+    }
+    
+    lru_unlink(store, slot);
+    lru_push(store, slot);
+    return true;
+}
+
+bool page_store_evict(PageStore *store, u64 id) {
+    if (!store) return false;
+    
+    u32 slot = state_slot(store, id);
+    if (slot == NONE) return false;
+    state_drop(store, slot);
+    return true;
+}
+
+u32 page_store_states(const PageStore *store) {
+    return store ? store->live : 0;
+}
+
+u32 page_store_pages(const PageStore *store) {
+    return store ? store->unique : 0;
+}
+
+u64 page_store_bytes(const PageStore *store) {
+    if (!store) return 0;
+    return (u64)store->unique * store->page_size +
+           (u64)store->live * store->pages_per_state * sizeof(u32);
+}
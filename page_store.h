@@ -0,0 +1,38 @@
+#ifndef PAGE_STORE_H
+#define PAGE_STORE_H
+
+#include "types.h"
+
+// Content-addressed store for many fixed-size states
+//
+// Every state is split into pages of page_size bytes. Each page is hashed
+// and kept once no matter how many states contain it; a state is just the
+// list of its page numbers. Pages are reference counted and freed with the
+// last state that uses them. With a byte budget the least recently used
+// states (put or fetched) are evicted to stay under it.
+//
+// State ids are never reused, so fetching an evicted state fails cleanly.
+// Not thread-safe: use one store per thread or lock around it.
+
+typedef struct PageStore PageStore;
+
+// Store for states of state_size bytes (page_size: power of two, at least
+// 32). max_bytes = 0 disables eviction. Returns NULL on failure.
+PageStore *page_store_create(u32 state_size, u32 page_size, u64 max_bytes);
+void page_store_destroy(PageStore *store);
+
+// Add a state; returns its id (0 on allocation failure)
+u64 page_store_put(PageStore *store, const u8 *state);
+
+// Copy a state to out (state_size bytes); false if the id is unknown or evicted
+bool page_store_get(PageStore *store, u64 id, u8 *out);
+
+// Drop a state now; false if it is already gone
+bool page_store_evict(PageStore *store, u64 id);
+
+// Live states, unique pages, and host bytes held (pages + page tables)
+u32 page_store_states(const PageStore *store);
+u32 page_store_pages(const PageStore *store);
+u64 page_store_bytes(const PageStore *store);
+
+#endif // PAGE_STORE_H
@@ -1,335 +1,683 @@
-"""
-Pokemon Emerald OpenAI Gym Environment
-Wraps the native_emerald emulator for reinforcement learning
-"""
-
-import ctypes
-import numpy as np
-from pathlib import Path
-from typing import Tuple, Dict, Any, Optional
-import gymnasium as gym
-from gymnasium import spaces
-
-
-class EmeraldEnv(gym.Env):
-    """OpenAI Gym environment for Pokemon Emerald"""
-    
-    metadata = {'render_modes': ['human', 'rgb_array'], 'render_fps': 60}
-    
-    # GBA button mapping
-    KEY_A = 0x01
-    KEY_B = 0x02
-    KEY_SELECT = 0x04
-    KEY_START = 0x08
-    KEY_RIGHT = 0x10
-    KEY_LEFT = 0x20
-    KEY_UP = 0x40
-    KEY_DOWN = 0x80
-    
-    def __init__(self, rom_path: str, render_mode: Optional[str] = None):
-        """
-        Initialize Pokemon Emerald environment
-        
-        Args:
-            rom_path: Path to pokeemerald.gba ROM file
-            render_mode: 'human' for window, 'rgb_array' for numpy array
-        """
-        super().__init__()
-        
-        self.render_mode = render_mode
-        self.rom_path = str(Path(rom_path).resolve())
-        
-        # Action space: 8 buttons (each can be pressed or not)
-        # We'll use discrete actions for simplicity
-        self.action_space = spaces.Discrete(9)  # 0=nothing, 1-8=individual buttons
-        
-        # Observation space: GBA screen (240x160 RGB)
-        self.observation_space = spaces.Box(
-            low=0, high=255,
-            shape=(160, 240, 3),
-            dtype=np.uint8
-        )
-        
-        # Load emulator library
-        lib_path = Path(__file__).parent.parent / 'build' / 'libpokemon_emu_lib.so'
-        if not lib_path.exists():
-            raise FileNotFoundError(f"Emulator library not found: {lib_path}")
-        
-        self.lib = ctypes.CDLL(str(lib_path))
-        
-        # Define C function signatures
-        self._setup_ctypes()
-        
-        # Emulator state (opaque pointer)
-        self.emu_state = None
-        
-        # Frame buffer
-        self.frame_buffer = np.zeros((160, 240, 3), dtype=np.uint8)
-        
-        # Statistics
-        self.frame_count = 0
-        self.episode_reward = 0.0
-    
-    def _setup_ctypes(self):
-        """Setup ctypes function signatures for emulator library"""
-        
-        # TODO: Define actual C API functions
-        # For now, placeholder signatures
-        
-        # emu_init(rom_path) -> void*
-        self.lib.emu_init.argtypes = [ctypes.c_char_p]
-        self.lib.emu_init.restype = ctypes.c_void_p
-        
-        # emu_step(state, buttons) -> void
-        self.lib.emu_step.argtypes = [ctypes.c_void_p, ctypes.c_uint8]
-        self.lib.emu_step.restype = None
-        
-        # emu_get_screen(state, buffer) -> void
-        self.lib.emu_get_screen.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint8)]
-        self.lib.emu_get_screen.restype = None
-        
-        # emu_reset(state) -> void
-        self.lib.emu_reset.argtypes = [ctypes.c_void_p]
-        self.lib.emu_reset.restype = None
-        
-        # emu_cleanup(state) -> void
-        self.lib.emu_cleanup.argtypes = [ctypes.c_void_p]
-        self.lib.emu_cleanup.restype = None
-        
-        # emu_read_memory(state, addr) -> u8
-        self.lib.emu_read_memory.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
-        self.lib.emu_read_memory.restype = ctypes.c_uint8
-        
-        # emu_write_memory(state, addr, value) -> void
-        self.lib.emu_write_memory.argtypes = [ctypes.c_void_p, ctypes.c_uint32, ctypes.c_uint8]
-        self.lib.emu_write_memory.restype = None
-    
-    def reset(self, seed: Optional[int] = None, options: Optional[Dict] = None) -> Tuple[np.ndarray, Dict]:
-        """
-        Reset the environment to initial state
-        
-        Returns:
-            observation: Initial screen
-            info: Additional information
-        """
-        super().reset(seed=seed)
-        
-        if self.emu_state is None:
-            # First initialization
-            self.emu_state = self.lib.emu_init(self.rom_path.encode('utf-8'))
-        else:
-            # Reset existing emulator
-            self.lib.emu_reset(self.emu_state)
-        
-        # Get initial observation
-        observation = self._get_observation()
-        
-        self.frame_count = 0
-        self.episode_reward = 0.0
-        
-        info = {
-            'frame': self.frame_count,
-            'episode_reward': self.episode_reward
-        }
-        
-        return observation, info
-    
-    def step(self, action: int) -> Tuple[np.ndarray, float, bool, bool, Dict]:
-        """
-        Execute one step in the environment
-        
-        Args:
-            action: Action to take (0-8)
-        
-        Returns:
-            observation: Screen after action
-            reward: Reward for this step
-            terminated: Whether episode is done
-            truncated: Whether episode was truncated
-            info: Additional information
-        """
-        # Map discrete action to button press
-        buttons = self._action_to_buttons(action)
-        
-        # Execute one frame
-        self.lib.emu_step(self.emu_state, buttons)
-        
-        # Get new observation
-        observation = self._get_observation()
-        
-        # Calculate reward (placeholder)
-        reward = self._calculate_reward()
-        
-        # Check if episode is done (placeholder)
-        terminated = False
-        truncated = False
-        
-        self.frame_count += 1
-        self.episode_reward += reward
-        
-        info = {
-            'frame': self.frame_count,
-            'episode_reward': self.episode_reward,
-            'buttons': buttons
-        }
-        
-        return observation, reward, terminated, truncated, info
-    
-    def render(self):
-        """Render the environment"""
-        if self.render_mode == 'rgb_array':
-            return self._get_observation()
-        elif self.render_mode == 'human':
-            # SDL window is already rendering
-            pass
-    
-    def close(self):
-        """Cleanup resources"""
-        if self.emu_state is not None:
-            self.lib.emu_cleanup(self.emu_state)
-            self.emu_state = None
-    
-    def _action_to_buttons(self, action: int) -> int:
-        """Convert discrete action to button bitmask"""
-        if action == 0:
-            return 0  # No buttons
-        elif action == 1:
-            return self.KEY_A
-        elif action == 2:
-            return self.KEY_B
-        elif action == 3:
-            return self.KEY_UP
-        elif action == 4:
-            return self.KEY_DOWN
-        elif action == 5:
-            return self.KEY_LEFT
-        elif action == 6:
-            return self.KEY_RIGHT
-        elif action == 7:
-            return self.KEY_START
-        elif action == 8:
-            return self.KEY_SELECT
-        return 0
-    
-    def _get_observation(self) -> np.ndarray:
-        """Get current screen as numpy array"""
-        # Copy screen data from emulator
-        buffer_ptr = self.frame_buffer.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8))
-        self.lib.emu_get_screen(self.emu_state, buffer_ptr)
-        return self.frame_buffer.copy()
-    
-    def _calculate_reward(self) -> float:
-        """Calculate reward for current state"""
-        # Track progress metrics
-        if not hasattr(self, '_prev_state'):
-            self._prev_state = {
-                'badges': 0,
-                'money': 0,
-                'party_hp': 0,
-                'map_id': 0,
-                'frame': 0
-            }
-        
-        reward = 0.0
-        
-        # Get current game state
-        badges = self.read_memory(0x0202420C)
-        money = (self.read_memory(0x02024490) |
-                 (self.read_memory(0x02024491) << 8) |
-                 (self.read_memory(0x02024492) << 16) |
-                 (self.read_memory(0x02024493) << 24))
-        
-        # Reward for gaining badges (huge reward)
-        badge_count = bin(badges).count('1')
-        prev_badge_count = bin(self._prev_state['badges']).count('1')
-        if badge_count > prev_badge_count:
-            reward += 1000.0 * (badge_count - prev_badge_count)
-            print(f"🏆 New badge! Total: {badge_count}")
-        
-        # Reward for gaining money (small reward)
-        money_gained = money - self._prev_state['money']
-        if money_gained > 0:
-            reward += money_gained / 1000.0  # Scale down
-        
-        # Penalty for losing HP
-        party_count = self.read_memory(0x02024284)
-        if party_count > 0 and party_count <= 6:
-            total_hp = 0
-            for i in range(party_count):
-                hp_addr = 0x02024284 + 4 + (i * 100) + 0x56
-                hp = self.read_memory(hp_addr) | (self.read_memory(hp_addr + 1) << 8)
-                total_hp += hp
-            
-            hp_lost = self._prev_state['party_hp'] - total_hp
-            if hp_lost > 0:
-                reward -= hp_lost * 0.1
-        
-        # Small reward for exploring (new map)
-        map_id = self.read_memory(0x02036DFD)
-        if map_id != self._prev_state['map_id']:
-            reward += 5.0
-        
-        # Small time penalty to encourage progress
-        reward -= 0.01
-        
-        # Update previous state
-        self._prev_state = {
-            'badges': badges,
-            'money': money,
-            'party_hp': total_hp if party_count > 0 else 0,
-            'map_id': map_id,
-            'frame': self.frame_count
-        }
-        
-        return reward
-    
-    def read_memory(self, addr: int) -> int:
-        """Read byte from emulator memory"""
-        return self.lib.emu_read_memory(self.emu_state, addr)
-    
-    def write_memory(self, addr: int, value: int):
-        """Write byte to emulator memory"""
-        self.lib.emu_write_memory(self.emu_state, addr, value & 0xFF)
-    
-    def get_game_state(self) -> Dict[str, Any]:
-        """Extract game state from memory (placeholder)"""
-        # TODO: Parse Pokemon Emerald memory to extract:
-        # - Player position
-        # - Party Pokemon (species, HP, level, etc.)
-        # - Inventory
-        # - Badges
-        # - Current map
-        # - Battle state
-        
-        return {
-            'player_x': 0,
-            'player_y': 0,
-            'map_id': 0,
-            'party_count': 0,
-        }
-
-
-if __name__ == '__main__':
-    # Test the environment
-    import time
-    
-    env = EmeraldEnv('../pokeemerald.gba', render_mode='human')
-    
-    observation, info = env.reset()
-    print(f"Observation shape: {observation.shape}")
-    print(f"Action space: {env.action_space}")
-    
-    # Run for 1000 frames
-    for i in range(1000):
-        action = env.action_space.sample()  # Random action
-        observation, reward, terminated, truncated, info = env.step(action)
-        
-        if i % 60 == 0:
-            print(f"Frame {info['frame']}, Reward: {reward:.2f}")
-        
-        if terminated or truncated:
-            observation, info = env.reset()
-        
-        time.sleep(1/60)  # 60 FPS
-    
-    env.close()
+"""
+Pokemon Emerald OpenAI Gym Environment
+Wraps the native_emerald emulator for reinforcement learning
+"""
+
+import ctypes
+import numpy as np
+from pathlib import Path
+from typing import Callable, Tuple, Dict, Any, Optional
+import gymnasium as gym
+from gymnasium import spaces
+
+
+# emu_set_screen_format formats: (numpy dtype, shape)
+SCREEN_FORMATS = {
+    0: (np.uint8, (160, 240, 3)),   # EMU_SCREEN_RGB888
+    1: (np.uint16, (160, 240)),     # EMU_SCREEN_RGB565
+    2: (np.uint8, (160, 240)),      # EMU_SCREEN_GRAY8
+}
+
+# emu_get_memory_ptr regions: (region id, GBA base address)
+MEMORY_REGIONS = {
+    'ewram': (0, 0x02000000),
+    'iwram': (1, 0x03000000),
+    'vram': (2, 0x06000000),
+    'oam': (3, 0x07000000),
+    'palette': (4, 0x05000000),
+    'sram': (5, 0x0E000000),
+}
+
+# Granularity of emu_get_dirty_pages (EMU_PAGE_SIZE)
+PAGE_SIZE = 256
+
+
+def setup_view_ctypes(lib):
+    """Declare the zero-copy view functions of the emulator library"""
+    # emu_set_screen_format(state, format) -> void
+    lib.emu_set_screen_format.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+    lib.emu_set_screen_format.restype = None
+    
+    # emu_get_screen_ptr(state) -> const u8*
+    lib.emu_get_screen_ptr.argtypes = [ctypes.c_void_p]
+    lib.emu_get_screen_ptr.restype = ctypes.c_void_p
+    
+    # emu_get_screen_size(state) -> u32
+    lib.emu_get_screen_size.argtypes = [ctypes.c_void_p]
+    lib.emu_get_screen_size.restype = ctypes.c_uint32
+    
+    # emu_set_render_policy(state, policy, interval) -> void
+    lib.emu_set_render_policy.argtypes = [ctypes.c_void_p, ctypes.c_uint32, ctypes.c_uint32]
+    lib.emu_set_render_policy.restype = None
+    
+    # emu_get_memory_ptr(state, region, size*) -> u8*
+    lib.emu_get_memory_ptr.argtypes = [ctypes.c_void_p, ctypes.c_uint32,
+                                       ctypes.POINTER(ctypes.c_uint32)]
+    lib.emu_get_memory_ptr.restype = ctypes.c_void_p
+    
+    # emu_get_dirty_pages(state, region, pages*, max) -> u32
+    lib.emu_get_dirty_pages.argtypes = [ctypes.c_void_p, ctypes.c_uint32,
+                                        ctypes.POINTER(ctypes.c_uint32), ctypes.c_uint32]
+    lib.emu_get_dirty_pages.restype = ctypes.c_uint32
+    
+    # emu_clear_dirty(state) -> void
+    lib.emu_clear_dirty.argtypes = [ctypes.c_void_p]
+    lib.emu_clear_dirty.restype = None
+
+
+def wrap_pointer(address: int, size: int, dtype=np.uint8) -> np.ndarray:
+    """numpy array over native memory (no copy; valid while the emulator lives)"""
+    return np.frombuffer((ctypes.c_uint8 * size).from_address(address), dtype=dtype)
+
+
+def screen_view(lib, handle, screen_format: int = 0) -> np.ndarray:
+    """Live view of an emulator's screen in the given EMU_SCREEN_* format"""
+    dtype, shape = SCREEN_FORMATS[screen_format]
+    lib.emu_set_screen_format(handle, screen_format)
+    address = lib.emu_get_screen_ptr(handle)
+    return wrap_pointer(address, lib.emu_get_screen_size(handle), dtype).reshape(shape)
+
+
+def memory_views(lib, handle) -> Dict[str, np.ndarray]:
+    """Live views of an emulator's RAM regions, keyed by MEMORY_REGIONS name"""
+    views = {}
+    for name, (region, _) in MEMORY_REGIONS.items():
+        size = ctypes.c_uint32(0)
+        address = lib.emu_get_memory_ptr(handle, region, ctypes.byref(size))
+        views[name] = wrap_pointer(address, size.value)
+    return views
+
+
+def dirty_pages(lib, handle, name: str) -> np.ndarray:
+    """Indices of the PAGE_SIZE pages of a MEMORY_REGIONS region written since emu_clear_dirty"""
+    region = MEMORY_REGIONS[name][0]
+    count = lib.emu_get_dirty_pages(handle, region, None, 0)
+    pages = np.empty(count, dtype=np.uint32)
+    if count:
+        lib.emu_get_dirty_pages(handle, region,
+                                pages.ctypes.data_as(ctypes.POINTER(ctypes.c_uint32)), count)
+    return pages
+
+
+def memory_reader(views: Dict[str, np.ndarray],
+                  fallback: Callable[[int], int]) -> Callable[[int], int]:
+    """
+    Byte reader for calculate_reward that indexes the RAM views directly
+    
+    Addresses outside EWRAM/IWRAM go through fallback (emu_read_memory).
+    """
+    ewram = views['ewram']
+    iwram = views['iwram']
+    
+    def read(addr: int) -> int:
+        region = addr >> 24
+        if region == 0x02:
+            return int(ewram[addr & 0x3FFFF])
+        if region == 0x03:
+            return int(iwram[addr & 0x7FFF])
+        return fallback(addr)
+    
+    return read
+
+
+def initial_reward_state() -> Dict[str, int]:
+    """Progress metrics before the first step"""
+    return {
+        'badges': 0,
+        'money': 0,
+        'party_hp': 0,
+        'map_id': 0,
+        'frame': 0
+    }
+
+
+def calculate_reward(read_memory: Callable[[int], int], prev_state: Dict[str, int],
+                     frame_count: int) -> Tuple[float, Dict[str, int]]:
+    """
+    Reward for the current game state
+    
+    Args:
+        read_memory: Reads one byte of emulator memory
+        prev_state: Metrics returned by the previous call (or initial_reward_state())
+        frame_count: Frames stepped so far
+    
+    Returns:
+        reward, metrics to pass to the next call
+    """
+    reward = 0.0
+    
+    # Get current game state
+    badges = read_memory(0x0202420C)
+    money = (read_memory(0x02024490) |
+             (read_memory(0x02024491) << 8) |
+             (read_memory(0x02024492) << 16) |
+             (read_memory(0x02024493) << 24))
+    
+    # Reward for gaining badges (huge reward)
+    badge_count = bin(badges).count('1')
+    prev_badge_count = bin(prev_state['badges']).count('1')
+    if badge_count > prev_badge_count:
+        reward += 1000.0 * (badge_count - prev_badge_count)
+        print(f"🏆 New badge! Total: {badge_count}")
+    
+    # Reward for gaining money (small reward)
+    money_gained = money - prev_state['money']
+    if money_gained > 0:
+        reward += money_gained / 1000.0  # Scale down
+    
+    # Penalty for losing HP
+    party_count = read_memory(0x02024284)
+    total_hp = 0
+    if party_count > 0 and party_count <= 6:
+        for i in range(party_count):
+            hp_addr = 0x02024284 + 4 + (i * 100) + 0x56
+            hp = read_memory(hp_addr) | (read_memory(hp_addr + 1) << 8)
+            total_hp += hp
+        
+        hp_lost = prev_state['party_hp'] - total_hp
+        if hp_lost > 0:
+            reward -= hp_lost * 0.1
+    
+    # Small reward for exploring (new map)
+    map_id = read_memory(0x02036DFD)
+    if map_id != prev_state['map_id']:
+        reward += 5.0
+    
+    # Small time penalty to encourage progress
+    reward -= 0.01
+    
+    # Update previous state
+    state = {
+        'badges': badges,
+        'money': money,
+        'party_hp': total_hp,
+        'map_id': map_id,
+        'frame': frame_count
+    }
+    
+    return reward, state
+
+
+class EmeraldEnv(gym.Env):
+    """OpenAI Gym environment for Pokemon Emerald"""
+    
+    metadata = {'render_modes': ['human', 'rgb_array'], 'render_fps': 60}
+    
+    # GBA button mapping
+    KEY_A = 0x01
+    KEY_B = 0x02
+    KEY_SELECT = 0x04
+    KEY_START = 0x08
+    KEY_RIGHT = 0x10
+    KEY_LEFT = 0x20
+    KEY_UP = 0x40
+    KEY_DOWN = 0x80
+    
+    # emu_init_ex flags
+    EMU_INIT_JIT = 1 << 0
+    
+    # emu_step_n flags
+    EMU_STEP_MAX_POOL = 1 << 0
+    EMU_STEP_REWARD = 1 << 1
+    
+    # emu_set_render_policy policies
+    EMU_RENDER_ALWAYS = 0
+    EMU_RENDER_NEVER = 1
+    EMU_RENDER_EVERY_N = 2
+    EMU_RENDER_LAZY = 3
+    
+    def __init__(self, rom_path: str, render_mode: Optional[str] = None, use_jit: bool = False,
+                 copy_obs: bool = True, frame_skip: int = 1, max_pool: bool = False,
+                 native_reward: bool = False):
+        """
+        Initialize Pokemon Emerald environment
+        
+        Args:
+            rom_path: Path to pokeemerald.gba ROM file
+            render_mode: 'human' for window, 'rgb_array' for numpy array
+            use_jit: Enable the experimental x86-64 Thumb recompiler
+            copy_obs: Return a copy of the screen; False returns the live view,
+                      which the next step overwrites
+            frame_skip: Frames each action is held for (one native call per step)
+            max_pool: Observe the per-channel max of the last two frames
+            native_reward: Sum the reward over every frame in C instead of
+                           computing it in Python once per step
+        """
+        super().__init__()
+        
+        self.render_mode = render_mode
+        self.use_jit = use_jit
+        self.copy_obs = copy_obs
+        self.frame_skip = frame_skip
+        self.native_reward = native_reward
+        self.step_flags = ((self.EMU_STEP_MAX_POOL if max_pool else 0) |
+                           (self.EMU_STEP_REWARD if native_reward else 0))
+        self.rom_path = str(Path(rom_path).resolve())
+        
+        # Action space: 8 buttons (each can be pressed or not)
+        # We'll use discrete actions for simplicity
+        self.action_space = spaces.Discrete(9)  # 0=nothing, 1-8=individual buttons
+        
+        # Observation space: GBA screen (240x160 RGB)
+        self.observation_space = spaces.Box(
+            low=0, high=255,
+            shape=(160, 240, 3),
+            dtype=np.uint8
+        )
+        
+        # Load emulator library
+        lib_path = Path(__file__).parent.parent / 'build' / 'libpokemon_emu_lib.so'
+        if not lib_path.exists():
+            raise FileNotFoundError(f"Emulator library not found: {lib_path}")
+        
+        self.lib = ctypes.CDLL(str(lib_path))
+        
+        # Define C function signatures
+        self._setup_ctypes()
+        
+        # Emulator state (opaque pointer)
+        self.emu_state = None
+        
+        # Live views of the emulator's screen and RAM (set up on first reset)
+        self.screen = None
+        self.memory = {}
+        self._read = self.read_memory
+        
+        # Statistics
+        self.frame_count = 0
+        self.episode_reward = 0.0
+    
+    def _setup_ctypes(self):
+        """Setup ctypes function signatures for emulator library"""
+        
+        # TODO: Define actual C API functions
+        # For now, placeholder signatures
+        
+        # emu_init(rom_path) -> void*
+        self.lib.emu_init.argtypes = [ctypes.c_char_p]
+        self.lib.emu_init.restype = ctypes.c_void_p
+        
+        # emu_init_ex(rom_path, flags) -> void*
+        self.lib.emu_init_ex.argtypes = [ctypes.c_char_p, ctypes.c_uint32]
+        self.lib.emu_init_ex.restype = ctypes.c_void_p
+        
+        # emu_step(state, buttons) -> void
+        self.lib.emu_step.argtypes = [ctypes.c_void_p, ctypes.c_uint8]
+        self.lib.emu_step.restype = None
+        
+        # emu_step_n(state, buttons, n, flags) -> float
+        self.lib.emu_step_n.argtypes = [ctypes.c_void_p, ctypes.c_uint8, ctypes.c_uint32,
+                                        ctypes.c_uint32]
+        self.lib.emu_step_n.restype = ctypes.c_float
+        
+        # emu_get_screen(state, buffer) -> void
+        self.lib.emu_get_screen.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint8)]
+        self.lib.emu_get_screen.restype = None
+        
+        # emu_reset(state) -> void
+        self.lib.emu_reset.argtypes = [ctypes.c_void_p]
+        self.lib.emu_reset.restype = None
+        
+        # emu_cleanup(state) -> void
+        self.lib.emu_cleanup.argtypes = [ctypes.c_void_p]
+        self.lib.emu_cleanup.restype = None
+        
+        # emu_read_memory(state, addr) -> u8
+        self.lib.emu_read_memory.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+        self.lib.emu_read_memory.restype = ctypes.c_uint8
+        
+        # emu_write_memory(state, addr, value) -> void
+        self.lib.emu_write_memory.argtypes = [ctypes.c_void_p, ctypes.c_uint32, ctypes.c_uint8]
+        self.lib.emu_write_memory.restype = None
+        
+        # emu_snapshot_size() -> u32
+        self.lib.emu_snapshot_size.argtypes = []
+        self.lib.emu_snapshot_size.restype = ctypes.c_uint32
+        
+        # emu_snapshot(state, buffer) / emu_restore(state, buffer) -> bool
+        self.lib.emu_snapshot.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+        self.lib.emu_snapshot.restype = ctypes.c_bool
+        self.lib.emu_restore.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+        self.lib.emu_restore.restype = ctypes.c_bool
+        
+        # emu_rewind_enable(state, keyframe_interval, max_bytes) -> bool
+        self.lib.emu_rewind_enable.argtypes = [ctypes.c_void_p, ctypes.c_uint32, ctypes.c_uint32]
+        self.lib.emu_rewind_enable.restype = ctypes.c_bool
+        
+        # emu_rewind(state, frames) -> u32, emu_rewind_depth(state) -> u32
+        self.lib.emu_rewind.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+        self.lib.emu_rewind.restype = ctypes.c_uint32
+        self.lib.emu_rewind_depth.argtypes = [ctypes.c_void_p]
+        self.lib.emu_rewind_depth.restype = ctypes.c_uint32
+        
+        # emu_fork(state) -> void*
+        self.lib.emu_fork.argtypes = [ctypes.c_void_p]
+        self.lib.emu_fork.restype = ctypes.c_void_p
+        
+        # emu_save_state(state, filename) / emu_load_state(state, filename) -> bool
+        self.lib.emu_save_state.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        self.lib.emu_save_state.restype = ctypes.c_bool
+        self.lib.emu_load_state.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        self.lib.emu_load_state.restype = ctypes.c_bool
+        
+        setup_view_ctypes(self.lib)
+    
+    def reset(self, seed: Optional[int] = None, options: Optional[Dict] = None) -> Tuple[np.ndarray, Dict]:
+        """
+        Reset the environment to initial state
+        
+        Returns:
+            observation: Initial screen
+            info: Additional information
+        """
+        super().reset(seed=seed)
+        
+        if self.emu_state is None:
+            # First initialization
+            flags = self.EMU_INIT_JIT if self.use_jit else 0
+            self.emu_state = self.lib.emu_init_ex(self.rom_path.encode('utf-8'), flags)
+            if not self.emu_state:
+                raise RuntimeError(f"Failed to initialize emulator with {self.rom_path}")
+            
+            # Wrap screen and RAM once; they are updated in place from now on
+            self.screen = screen_view(self.lib, self.emu_state)
+            self.memory = memory_views(self.lib, self.emu_state)
+            self._read = memory_reader(self.memory, self.read_memory)
+        else:
+            # Reset existing emulator
+            self.lib.emu_reset(self.emu_state)
+        
+        # Get initial observation
+        observation = self._get_observation()
+        
+        self.frame_count = 0
+        self.episode_reward = 0.0
+        
+        info = {
+            'frame': self.frame_count,
+            'episode_reward': self.episode_reward
+        }
+        
+        return observation, info
+    
+    def step(self, action: int) -> Tuple[np.ndarray, float, bool, bool, Dict]:
+        """
+        Execute one step in the environment
+        
+        Args:
+            action: Action to take (0-8)
+        
+        Returns:
+            observation: Screen after action
+            reward: Reward for this step
+            terminated: Whether episode is done
+            truncated: Whether episode was truncated
+            info: Additional information
+        """
+        # Map discrete action to button press
+        buttons = self._action_to_buttons(action)
+        
+        # Hold the buttons for frame_skip frames (rendering only what we observe)
+        native = self.lib.emu_step_n(self.emu_state, buttons, self.frame_skip, self.step_flags)
+        
+        # Get new observation
+        observation = self._get_observation()
+        
+        # Calculate reward (placeholder)
+        reward = native if self.native_reward else self._calculate_reward()
+        
+        # Check if episode is done (placeholder)
+        terminated = False
+        truncated = False
+        
+        self.frame_count += self.frame_skip
+        self.episode_reward += reward
+        
+        info = {
+            'frame': self.frame_count,
+            'episode_reward': self.episode_reward,
+            'buttons': buttons
+        }
+        
+        return observation, reward, terminated, truncated, info
+    
+    def render(self):
+        """Render the environment"""
+        if self.render_mode == 'rgb_array':
+            return self._get_observation()
+        elif self.render_mode == 'human':
+            # SDL window is already rendering
+            pass
+    
+    def close(self):
+        """Cleanup resources"""
+        if self.emu_state is not None:
+            # The views point into the emulator being freed
+            self.screen = None
+            self.memory = {}
+            self._read = self.read_memory
+            self.lib.emu_cleanup(self.emu_state)
+            self.emu_state = None
+    
+    def _action_to_buttons(self, action: int) -> int:
+        """Convert discrete action to button bitmask"""
+        if action == 0:
+            return 0  # No buttons
+        elif action == 1:
+            return self.KEY_A
+        elif action == 2:
+            return self.KEY_B
+        elif action == 3:
+            return self.KEY_UP
+        elif action == 4:
+            return self.KEY_DOWN
+        elif action == 5:
+            return self.KEY_LEFT
+        elif action == 6:
+            return self.KEY_RIGHT
+        elif action == 7:
+            return self.KEY_START
+        elif action == 8:
+            return self.KEY_SELECT
+        return 0
+    
+    def _get_observation(self) -> np.ndarray:
+        """Get current screen as numpy array"""
+        # Asking for the pointer draws a frame deferred by EMU_RENDER_LAZY
+        self.lib.emu_get_screen_ptr(self.emu_state)
+        return self.screen.copy() if self.copy_obs else self.screen
+    
+    def _calculate_reward(self) -> float:
+        """Calculate reward for current state"""
+        if not hasattr(self, '_prev_state'):
+            self._prev_state = initial_reward_state()
+        
+        reward, self._prev_state = calculate_reward(self._read, self._prev_state, self.frame_count)
+        return reward
+    
+    def snapshot(self) -> np.ndarray:
+        """Capture the full emulator state in memory (no file I/O)"""
+        state = np.empty(self.lib.emu_snapshot_size(), dtype=np.uint8)
+        if not self.lib.emu_snapshot(self.emu_state, state.ctypes.data):
+            raise RuntimeError("emu_snapshot failed")
+        return state
+    
+    def restore(self, state: np.ndarray):
+        """Return to a state captured by snapshot()"""
+        if state.nbytes < self.lib.emu_snapshot_size():
+            raise ValueError("Snapshot buffer too small")
+        if not self.lib.emu_restore(self.emu_state, state.ctypes.data):
+            raise RuntimeError("emu_restore failed")
+    
+    def set_render_policy(self, policy: int, interval: int = 1):
+        """
+        Choose when emu_step draws the screen (EMU_RENDER_* constants)
+        
+        EMU_RENDER_LAZY draws only when an observation is taken, so agents
+        that skip frames or read only RAM don't pay for rendering.
+        """
+        self.lib.emu_set_render_policy(self.emu_state, policy, interval)
+    
+    def enable_rewind(self, keyframe_interval: int = 60, max_bytes: int = 64 << 20):
+        """Record every step for rewind() (max_bytes=0 turns it off)"""
+        if not self.lib.emu_rewind_enable(self.emu_state, keyframe_interval, max_bytes):
+            raise MemoryError("emu_rewind_enable failed")
+    
+    def rewind(self, frames: int) -> int:
+        """
+        Undo up to 'frames' steps (e.g. back to before a wipe)
+        
+        Returns the number of steps undone; frame_count moves back with it.
+        """
+        undone = self.lib.emu_rewind(self.emu_state, frames)
+        self.frame_count = max(0, self.frame_count - undone)
+        return undone
+    
+    def fork(self) -> int:
+        """
+        Branch the current state into a new emulator handle (emu_fork)
+        
+        Use the handle with the lib.emu_* functions and pass it to
+        release_fork() when done; released branches are recycled, so
+        forking again only copies the pages that changed.
+        """
+        handle = self.lib.emu_fork(self.emu_state)
+        if not handle:
+            raise RuntimeError("emu_fork failed")
+        return handle
+    
+    def release_fork(self, handle: int):
+        """Hand a fork() handle back for reuse"""
+        self.lib.emu_cleanup(handle)
+    
+    def dirty_pages(self, region: str) -> np.ndarray:
+        """Pages of a memory region written since the last clear_dirty()"""
+        return dirty_pages(self.lib, self.emu_state, region)
+    
+    def clear_dirty(self):
+        """Start a new dirty page interval"""
+        self.lib.emu_clear_dirty(self.emu_state)
+    
+    def read_memory(self, addr: int) -> int:
+        """Read byte from emulator memory"""
+        return self.lib.emu_read_memory(self.emu_state, addr)
+    
+    def write_memory(self, addr: int, value: int):
+        """Write byte to emulator memory"""
+        self.lib.emu_write_memory(self.emu_state, addr, value & 0xFF)
+    
+    def get_game_state(self) -> Dict[str, Any]:
+        """Extract game state from memory (placeholder)"""
+        # TODO: Parse Pokemon Emerald memory to extract:
+        # - Player position
+        # - Party Pokemon (species, HP, level, etc.)
+        # - Inventory
+        # - Badges
+        # - Current map
+        # - Battle state
+        
+        return {
+            'player_x': 0,
+            'player_y': 0,
+            'map_id': 0,
+            'party_count': 0,
+        }
+
+
+class StateStore:
+    """
+    Deduplicating archive of emulator states (emu_store_* API)
+    
+    States are split into 1KB pages and every distinct page is kept once, so
+    an archive of thousands of related states takes a small fraction of
+    their snapshot size. With max_bytes the least recently used states are
+    evicted; restore() then returns False for them.
+    """
+    
+    def __init__(self, lib, max_bytes: int = 0):
+        self.lib = lib
+        
+        # emu_store_create(max_bytes) -> void*
+        lib.emu_store_create.argtypes = [ctypes.c_uint64]
+        lib.emu_store_create.restype = ctypes.c_void_p
+        
+        # emu_store_put(store, state) -> u64 id
+        lib.emu_store_put.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+        lib.emu_store_put.restype = ctypes.c_uint64
+        
+        # emu_store_restore(store, state, id) / emu_store_evict(store, id) -> bool
+        lib.emu_store_restore.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_uint64]
+        lib.emu_store_restore.restype = ctypes.c_bool
+        lib.emu_store_evict.argtypes = [ctypes.c_void_p, ctypes.c_uint64]
+        lib.emu_store_evict.restype = ctypes.c_bool
+        
+        # emu_store_count(store) -> u32, emu_store_bytes(store) -> u64
+        lib.emu_store_count.argtypes = [ctypes.c_void_p]
+        lib.emu_store_count.restype = ctypes.c_uint32
+        lib.emu_store_bytes.argtypes = [ctypes.c_void_p]
+        lib.emu_store_bytes.restype = ctypes.c_uint64
+        
+        # emu_store_destroy(store) -> void
+        lib.emu_store_destroy.argtypes = [ctypes.c_void_p]
+        lib.emu_store_destroy.restype = None
+        
+        self.store = lib.emu_store_create(max_bytes)
+        if not self.store:
+            raise RuntimeError("emu_store_create failed")
+    
+    def put(self, env: 'EmeraldEnv') -> int:
+        """Archive the environment's current state; returns its id"""
+        state_id = self.lib.emu_store_put(self.store, env.emu_state)
+        if not state_id:
+            raise MemoryError("emu_store_put failed")
+        return state_id
+    
+    def restore(self, env: 'EmeraldEnv', state_id: int) -> bool:
+        """Load an archived state into env (False if it was evicted)"""
+        return self.lib.emu_store_restore(self.store, env.emu_state, state_id)
+    
+    def evict(self, state_id: int) -> bool:
+        """Drop an archived state"""
+        return self.lib.emu_store_evict(self.store, state_id)
+    
+    def __len__(self) -> int:
+        return self.lib.emu_store_count(self.store)
+    
+    @property
+    def nbytes(self) -> int:
+        """Host memory held by the archive"""
+        return self.lib.emu_store_bytes(self.store)
+    
+    def close(self):
+        if self.store:
+            self.lib.emu_store_destroy(self.store)
+            self.store = None
+    
+    def __del__(self):
+        self.close()
+
+
+if __name__ == '__main__':
+    # Test the environment
+    import time
+    
+    env = EmeraldEnv('../pokeemerald.gba', render_mode='human')
+    
+    observation, info = env.reset()
+    print(f"Observation shape: {observation.shape}")
+    print(f"Action space: {env.action_space}")
+    
+    # Run for 1000 frames
+    for i in range(1000):
+        action = env.action_space.sample()  # Random action
+        observation, reward, terminated, truncated, info = env.step(action)
+        
+        if i % 60 == 0:
+            print(f"Frame {info['frame']}, Reward: {reward:.2f}")
+        
+        if terminated or truncated:
+            observation, info = env.reset()
+        
+        time.sleep(1/60)  # 60 FPS
+    
+    env.close()
@@ -0,0 +1,214 @@
+"""
+Vectorized Pokemon Emerald environment
+Steps N emulators in one native call (emu_batch_* API) instead of N
+"""
+
+import ctypes
+import numpy as np
+from pathlib import Path
+from typing import Any, List, Optional, Sequence
+from gymnasium import spaces
+from stable_baselines3.common.vec_env import VecEnv
+
+from emerald_env import (EmeraldEnv, calculate_reward, initial_reward_state, memory_reader,
+                         memory_views, setup_view_ctypes)
+
+
+# Discrete action -> button bitmask (same mapping as EmeraldEnv)
+ACTION_BUTTONS = np.array([
+    0,
+    EmeraldEnv.KEY_A,
+    EmeraldEnv.KEY_B,
+    EmeraldEnv.KEY_UP,
+    EmeraldEnv.KEY_DOWN,
+    EmeraldEnv.KEY_LEFT,
+    EmeraldEnv.KEY_RIGHT,
+    EmeraldEnv.KEY_START,
+    EmeraldEnv.KEY_SELECT,
+], dtype=np.uint8)
+
+
+class EmeraldVecEnv(VecEnv):
+    """Stable Baselines3 VecEnv backed by a native emulator batch"""
+    
+    def __init__(self, rom_path: str, num_envs: int, use_jit: bool = False,
+                 num_threads: int = 0, frame_skip: int = 1, max_pool: bool = False,
+                 native_reward: bool = False):
+        """
+        Initialize a batch of Pokemon Emerald environments
+        
+        Args:
+            rom_path: Path to pokeemerald.gba ROM file
+            num_envs: Number of emulators
+            use_jit: Enable the experimental x86-64 Thumb recompiler
+            num_threads: Worker threads (0 = one per CPU)
+            frame_skip: Frames each action is held for (one native call per step)
+            max_pool: Observe the per-channel max of the last two frames
+            native_reward: Sum the reward over every frame in C (see EmeraldEnv)
+        """
+        observation_space = spaces.Box(
+            low=0, high=255,
+            shape=(160, 240, 3),
+            dtype=np.uint8
+        )
+        action_space = spaces.Discrete(9)  # Same actions as EmeraldEnv
+        super().__init__(num_envs, observation_space, action_space)
+        
+        # Load emulator library
+        lib_path = Path(__file__).parent.parent / 'build' / 'libpokemon_emu_lib.so'
+        if not lib_path.exists():
+            raise FileNotFoundError(f"Emulator library not found: {lib_path}")
+        
+        self.lib = ctypes.CDLL(str(lib_path))
+        self._setup_ctypes()
+        
+        flags = EmeraldEnv.EMU_INIT_JIT if use_jit else 0
+        rom_path = str(Path(rom_path).resolve())
+        self.batch = self.lib.emu_batch_create_ex(num_envs, rom_path.encode('utf-8'),
+                                                  flags, num_threads)
+        if not self.batch:
+            raise RuntimeError(f"Failed to create {num_envs} emulators for {rom_path}")
+        self.handles = [self.lib.emu_batch_get(self.batch, i) for i in range(num_envs)]
+        
+        # Reward reads index each instance's RAM in place
+        self.readers = [
+            memory_reader(memory_views(self.lib, handle),
+                          lambda addr, handle=handle: self.lib.emu_read_memory(handle, addr))
+            for handle in self.handles
+        ]
+        
+        # Buffers handed to the native side
+        self.obs_buffer = np.zeros((num_envs, 160, 240, 3), dtype=np.uint8)
+        self.button_buffer = np.zeros(num_envs, dtype=np.uint8)
+        self.reward_buffer = np.zeros(num_envs, dtype=np.float32)
+        
+        # Action repeat and reward source
+        self.frame_skip = frame_skip
+        self.native_reward = native_reward
+        self.step_flags = ((EmeraldEnv.EMU_STEP_MAX_POOL if max_pool else 0) |
+                           (EmeraldEnv.EMU_STEP_REWARD if native_reward else 0))
+        
+        # Per-environment episode state
+        self.frame_counts = np.zeros(num_envs, dtype=np.int64)
+        self.episode_rewards = np.zeros(num_envs, dtype=np.float64)
+        self.reward_states = [initial_reward_state() for _ in range(num_envs)]
+        self.actions = None
+    
+    def _setup_ctypes(self):
+        """Setup ctypes function signatures for the batch API"""
+        
+        # emu_batch_create_ex(count, rom_path, flags, threads) -> void*
+        self.lib.emu_batch_create_ex.argtypes = [ctypes.c_uint32, ctypes.c_char_p,
+                                                 ctypes.c_uint32, ctypes.c_uint32]
+        self.lib.emu_batch_create_ex.restype = ctypes.c_void_p
+        
+        # emu_batch_step_n(batch, actions, count, n, flags, rewards) -> void
+        self.lib.emu_batch_step_n.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint8),
+                                              ctypes.c_uint32, ctypes.c_uint32, ctypes.c_uint32,
+                                              ctypes.POINTER(ctypes.c_float)]
+        self.lib.emu_batch_step_n.restype = None
+        
+        # emu_batch_set_render_policy(batch, policy, interval) -> void
+        self.lib.emu_batch_set_render_policy.argtypes = [ctypes.c_void_p, ctypes.c_uint32,
+                                                         ctypes.c_uint32]
+        self.lib.emu_batch_set_render_policy.restype = None
+        
+        # emu_batch_get_obs(batch, out) -> void
+        self.lib.emu_batch_get_obs.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint8)]
+        self.lib.emu_batch_get_obs.restype = None
+        
+        # emu_batch_get(batch, index) -> void*
+        self.lib.emu_batch_get.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+        self.lib.emu_batch_get.restype = ctypes.c_void_p
+        
+        # emu_batch_destroy(batch) -> void
+        self.lib.emu_batch_destroy.argtypes = [ctypes.c_void_p]
+        self.lib.emu_batch_destroy.restype = None
+        
+        # emu_reset(state) -> void
+        self.lib.emu_reset.argtypes = [ctypes.c_void_p]
+        self.lib.emu_reset.restype = None
+        
+        # emu_read_memory(state, addr) -> u8
+        self.lib.emu_read_memory.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+        self.lib.emu_read_memory.restype = ctypes.c_uint8
+        
+        setup_view_ctypes(self.lib)
+    
+    def _get_observations(self) -> np.ndarray:
+        """Copy every screen into obs_buffer (one native call)"""
+        buffer_ptr = self.obs_buffer.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8))
+        self.lib.emu_batch_get_obs(self.batch, buffer_ptr)
+        return self.obs_buffer.copy()
+    
+    def set_render_policy(self, policy: int, interval: int = 1):
+        """Choose when every emulator draws its screen (EmeraldEnv.EMU_RENDER_*)"""
+        self.lib.emu_batch_set_render_policy(self.batch, policy, interval)
+    
+    def _reset_env(self, index: int):
+        self.lib.emu_reset(self.handles[index])
+        self.frame_counts[index] = 0
+        self.episode_rewards[index] = 0.0
+        self.reward_states[index] = initial_reward_state()
+    
+    def reset(self) -> np.ndarray:
+        for i in range(self.num_envs):
+            self._reset_env(i)
+        return self._get_observations()
+    
+    def step_async(self, actions: np.ndarray):
+        self.actions = actions
+    
+    def step_wait(self):
+        self.button_buffer[:] = ACTION_BUTTONS[np.asarray(self.actions, dtype=np.int64)]
+        
+        # All emulators advance frame_skip frames in parallel
+        buttons_ptr = self.button_buffer.ctypes.data_as(ctypes.POINTER(ctypes.c_uint8))
+        rewards_ptr = self.reward_buffer.ctypes.data_as(ctypes.POINTER(ctypes.c_float))
+        self.lib.emu_batch_step_n(self.batch, buttons_ptr, self.num_envs, self.frame_skip,
+                                  self.step_flags, rewards_ptr)
+        observations = self._get_observations()
+        
+        rewards = np.zeros(self.num_envs, dtype=np.float32)
+        dones = np.zeros(self.num_envs, dtype=bool)
+        infos = []
+        for i in range(self.num_envs):
+            if self.native_reward:
+                reward = float(self.reward_buffer[i])
+            else:
+                reward, self.reward_states[i] = calculate_reward(
+                    self.readers[i], self.reward_states[i], int(self.frame_counts[i]))
+            rewards[i] = reward
+            self.frame_counts[i] += self.frame_skip
+            self.episode_rewards[i] += reward
+            infos.append({
+                'frame': int(self.frame_counts[i]),
+                'episode_reward': float(self.episode_rewards[i]),
+                'buttons': int(self.button_buffer[i])
+            })
+        
+        return observations, rewards, dones, infos
+    
+    def close(self):
+        """Cleanup resources"""
+        if self.batch:
+            self.lib.emu_batch_destroy(self.batch)
+            self.batch = None
+            self.handles = []
+            self.readers = []
+    
+    def get_attr(self, attr_name: str, indices=None) -> List[Any]:
+        return [getattr(self, attr_name) for _ in self._get_indices(indices)]
+    
+    def set_attr(self, attr_name: str, value: Any, indices=None):
+        setattr(self, attr_name, value)
+    
+    def env_method(self, method_name: str, *method_args, indices=None, **method_kwargs) -> List[Any]:
+        raise NotImplementedError("EmeraldVecEnv has no per-environment objects")
+    
+    def env_is_wrapped(self, wrapper_class, indices=None) -> List[bool]:
+        return [False for _ in self._get_indices(indices)]
+    
+    def seed(self, seed: Optional[int] = None) -> Sequence[None]:
+        # The emulator is deterministic; nothing to seed
+        return [None for _ in range(self.num_envs)]
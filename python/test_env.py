@@ -1,144 +1,261 @@
-"""
-Test script for Pokemon Emerald Gym environment
-"""
-
-import sys
-from pathlib import Path
-
-# Add parent directory to path to import emerald_env
-sys.path.insert(0, str(Path(__file__).parent))
-
-from emerald_env import EmeraldEnv
-import numpy as np
-
-
-def test_basic_functionality():
-    """Test basic environment functionality"""
-    print("=== Testing Pokemon Emerald Gym Environment ===\n")
-    
-    # Find ROM
-    rom_paths = [
-        '../pokeemerald.gba',
-        '../../pokeemerald.gba',
-        '../../source/pokeemerald-master/pokeemerald.gba',
-    ]
-    
-    rom_path = None
-    for path in rom_paths:
-        if Path(path).exists():
-            rom_path = path
-            break
-    
-    if not rom_path:
-        print("ERROR: Could not find pokeemerald.gba ROM file")
-        print("Searched in:")
-        for path in rom_paths:
-            print(f"  - {Path(path).resolve()}")
-        return False
-    
-    print(f"Using ROM: {Path(rom_path).resolve()}\n")
-    
-    try:
-        # Create environment
-        print("Creating environment...")
-        env = EmeraldEnv(rom_path, render_mode='rgb_array')
-        print(f"✓ Environment created")
-        print(f"  Action space: {env.action_space}")
-        print(f"  Observation space: {env.observation_space}\n")
-        
-        # Reset
-        print("Resetting environment...")
-        observation, info = env.reset()
-        print(f"✓ Environment reset")
-        print(f"  Observation shape: {observation.shape}")
-        print(f"  Observation dtype: {observation.dtype}")
-        print(f"  Info: {info}\n")
-        
-        # Verify observation
-        assert observation.shape == (160, 240, 3), "Wrong observation shape"
-        assert observation.dtype == np.uint8, "Wrong observation dtype"
-        print("✓ Observation validation passed\n")
-        
-        # Run a few steps
-        print("Running 10 steps...")
-        for i in range(10):
-            action = env.action_space.sample()
-            observation, reward, terminated, truncated, info = env.step(action)
-            
-            print(f"  Step {i+1}: action={action}, reward={reward:.2f}, "
-                  f"terminated={terminated}, frame={info['frame']}")
-            
-            assert observation.shape == (160, 240, 3), "Wrong observation shape after step"
-        
-        print("\n✓ Steps completed successfully\n")
-        
-        # Test memory access
-        print("Testing memory access...")
-        test_addr = 0x02000000  # EWRAM start
-        
-        # Write
-        env.write_memory(test_addr, 0x42)
-        
-        # Read back
-        value = env.read_memory(test_addr)
-        assert value == 0x42, f"Memory read/write failed: expected 0x42, got {value:02X}"
-        
-        print(f"✓ Memory read/write working (wrote 0x42, read {value:02X})\n")
-        
-        # Cleanup
-        print("Cleaning up...")
-        env.close()
-        print("✓ Environment closed\n")
-        
-        print("=== All tests passed! ===")
-        return True
-        
-    except Exception as e:
-        print(f"\n✗ Test failed with error: {e}")
-        import traceback
-        traceback.print_exc()
-        return False
-
-
-def test_action_mapping():
-    """Test action to button mapping"""
-    print("\n=== Testing Action Mapping ===\n")
-    
-    rom_path = '../../source/pokeemerald-master/pokeemerald.gba'
-    if not Path(rom_path).exists():
-        print("Skipping action mapping test (ROM not found)")
-        return True
-    
-    env = EmeraldEnv(rom_path, render_mode='rgb_array')
-    
-    actions = {
-        0: "Nothing",
-        1: "A",
-        2: "B",
-        3: "Up",
-        4: "Down",
-        5: "Left",
-        6: "Right",
-        7: "Start",
-        8: "Select",
-    }
-    
-    print("Action -> Button mapping:")
-    for action, name in actions.items():
-        buttons = env._action_to_buttons(action)
-        print(f"  {action} ({name:7s}) -> 0x{buttons:02X}")
-    
-    env.close()
-    print("\n✓ Action mapping test passed\n")
-    return True
-
-
-if __name__ == '__main__':
-    success = True
-    
-    # Run tests
-    success &= test_basic_functionality()
-    success &= test_action_mapping()
-    
-    # Exit code
-    sys.exit(0 if success else 1)
+"""
+Test script for Pokemon Emerald Gym environment
+"""
+
+import sys
+from pathlib import Path
+
+# Add parent directory to path to import emerald_env
+sys.path.insert(0, str(Path(__file__).parent))
+
+from emerald_env import EmeraldEnv, calculate_reward, initial_reward_state
+import numpy as np
+
+
+def test_basic_functionality():
+    """Test basic environment functionality"""
+    print("=== Testing Pokemon Emerald Gym Environment ===\n")
+    
+    # Find ROM
+    rom_paths = [
+        '../pokeemerald.gba',
+        '../../pokeemerald.gba',
+        '../../source/pokeemerald-master/pokeemerald.gba',
+    ]
+    
+    rom_path = None
+    for path in rom_paths:
+        if Path(path).exists():
+            rom_path = path
+            break
+    
+    if not rom_path:
+        print("ERROR: Could not find pokeemerald.gba ROM file")
+        print("Searched in:")
+        for path in rom_paths:
+            print(f"  - {Path(path).resolve()}")
+        return False
+    
+    print(f"Using ROM: {Path(rom_path).resolve()}\n")
+    
+    try:
+        # Create environment
+        print("Creating environment...")
+        env = EmeraldEnv(rom_path, render_mode='rgb_array')
+        print(f"✓ Environment created")
+        print(f"  Action space: {env.action_space}")
+        print(f"  Observation space: {env.observation_space}\n")
+        
+        # Reset
+        print("Resetting environment...")
+        observation, info = env.reset()
+        print(f"✓ Environment reset")
+        print(f"  Observation shape: {observation.shape}")
+        print(f"  Observation dtype: {observation.dtype}")
+        print(f"  Info: {info}\n")
+        
+        # Verify observation
+        assert observation.shape == (160, 240, 3), "Wrong observation shape"
+        assert observation.dtype == np.uint8, "Wrong observation dtype"
+        print("✓ Observation validation passed\n")
+        
+        # Run a few steps
+        print("Running 10 steps...")
+        for i in range(10):
+            action = env.action_space.sample()
+            observation, reward, terminated, truncated, info = env.step(action)
+            
+            print(f"  Step {i+1}: action={action}, reward={reward:.2f}, "
+                  f"terminated={terminated}, frame={info['frame']}")
+            
+            assert observation.shape == (160, 240, 3), "Wrong observation shape after step"
+        
+        print("\n✓ Steps completed successfully\n")
+        
+        # Test memory access
+        print("Testing memory access...")
+        test_addr = 0x02000000  # EWRAM start
+        
+        # Write
+        env.write_memory(test_addr, 0x42)
+        
+        # Read back
+        value = env.read_memory(test_addr)
+        assert value == 0x42, f"Memory read/write failed: expected 0x42, got {value:02X}"
+        
+        print(f"✓ Memory read/write working (wrote 0x42, read {value:02X})\n")
+        
+        # Cleanup
+        print("Cleaning up...")
+        env.close()
+        print("✓ Environment closed\n")
+        
+        print("=== All tests passed! ===")
+        return True
+        
+    except Exception as e:
+        print(f"\n✗ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        return False
+
+
+def test_action_mapping():
+    """Test action to button mapping"""
+    print("\n=== Testing Action Mapping ===\n")
+    
+    rom_path = '../../source/pokeemerald-master/pokeemerald.gba'
+    if not Path(rom_path).exists():
+        print("Skipping action mapping test (ROM not found)")
+        return True
+    
+    env = EmeraldEnv(rom_path, render_mode='rgb_array')
+    
+    actions = {
+        0: "Nothing",
+        1: "A",
+        2: "B",
+        3: "Up",
+        4: "Down",
+        5: "Left",
+        6: "Right",
+        7: "Start",
+        8: "Select",
+    }
+    
+    print("Action -> Button mapping:")
+    for action, name in actions.items():
+        buttons = env._action_to_buttons(action)
+        print(f"  {action} ({name:7s}) -> 0x{buttons:02X}")
+    
+    env.close()
+    print("\n✓ Action mapping test passed\n")
+    return True
+
+
+def find_rom():
+    """First pokeemerald.gba in the usual places, or None"""
+    for path in ['../pokeemerald.gba', '../../pokeemerald.gba',
+                 '../../source/pokeemerald-master/pokeemerald.gba']:
+        if Path(path).exists():
+            return path
+    return None
+
+
+def test_native_reward():
+    """Test that the native reward (EMU_STEP_REWARD) matches calculate_reward"""
+    print("\n=== Testing Native Reward ===\n")
+    
+    # Fixed state without a ROM: a party count outside 1-6 counts as no HP
+    ram = {0x02024284: 7, 0x02024490: 0x88, 0x02024491: 0x13}
+    reward, state = calculate_reward(lambda addr: ram.get(addr, 0), initial_reward_state(), 0)
+    assert state['party_hp'] == 0, f"Party HP with 7 members: {state['party_hp']}"
+    assert abs(reward - (5.0 - 0.01)) < 1e-6, f"Reward for 5000 money: {reward}"
+    print("✓ Reward with an implausible party count")
+    
+    rom_path = find_rom()
+    if not rom_path:
+        print("Skipping native reward test (ROM not found)")
+        return True
+    
+    # One frame per step so the native reward covers the same frame
+    env = EmeraldEnv(rom_path, frame_skip=1, native_reward=True)
+    env.reset()
+    prev = initial_reward_state()
+    
+    def poke16(addr, value):
+        env.write_memory(addr, value)
+        env.write_memory(addr + 1, value >> 8)
+    
+    def hp_addr(slot):
+        return 0x02024284 + 4 + slot * 100 + 0x56
+    
+    # Each entry writes a fixed state before the step
+    edits = [
+        lambda: None,
+        lambda: (env.write_memory(0x02024284, 2), poke16(hp_addr(0), 100), poke16(hp_addr(1), 50)),
+        lambda: poke16(hp_addr(1), 20),                       # HP lost
+        lambda: poke16(0x02024490, 5000),                     # Money gained
+        lambda: env.write_memory(0x0202420C, 0x03),           # Two badges
+        lambda: env.write_memory(0x02036DFD, 0x2A),           # New map
+        lambda: env.write_memory(0x02024284, 7),              # Party count garbage
+        lambda: env.write_memory(0x02024284, 2),              # HP back
+    ]
+    
+    try:
+        for step in range(60 + len(edits)):
+            if step >= 60:
+                edits[step - 60]()
+            _, native, _, _, _ = env.step(0)
+            expected, prev = calculate_reward(env.read_memory, prev, env.frame_count)
+            assert abs(native - expected) < 1e-3, \
+                f"Step {step}: native reward {native}, calculate_reward {expected}"
+    finally:
+        env.close()
+    
+    print("✓ Native reward matches calculate_reward over fixed states\n")
+    return True
+
+
+def test_fork_reuse():
+    """Test that a recycled fork starts from the parent's current state"""
+    print("\n=== Testing Fork Reuse ===\n")
+    
+    rom_path = find_rom()
+    if not rom_path:
+        print("Skipping fork reuse test (ROM not found)")
+        return True
+    
+    env = EmeraldEnv(rom_path)
+    env.reset()
+    lib = env.lib
+    
+    def snapshot(handle):
+        state = np.empty(lib.emu_snapshot_size(), dtype=np.uint8)
+        assert lib.emu_snapshot(handle, state.ctypes.data), "emu_snapshot failed"
+        return state
+    
+    try:
+        for _ in range(120):
+            env.step(0)
+        
+        child = env.fork()
+        assert np.array_equal(snapshot(child), env.snapshot()), "Fresh fork differs from parent"
+        
+        # Diverge: different buttons, frame counts and RAM writes on each side
+        for i in range(90):
+            lib.emu_step(child, 0x08 if i % 20 < 10 else 0x01)
+        lib.emu_write_memory(child, 0x02001000, 0x5A)
+        for i in range(45):
+            env.step(1 if i % 2 else 7)
+        env.write_memory(0x03001000, 0xA5)
+        
+        env.release_fork(child)
+        again = env.fork()
+        assert again == child, "Released fork was not recycled"
+        assert np.array_equal(snapshot(again), env.snapshot()), "Recycled fork differs from parent"
+        
+        # And they stay in step from there
+        for _ in range(30):
+            lib.emu_step(again, 0x01)
+            lib.emu_step(env.emu_state, 0x01)
+        assert np.array_equal(snapshot(again), env.snapshot()), "Recycled fork diverged"
+        env.release_fork(again)
+    finally:
+        env.close()
+    
+    print("✓ Recycled fork matches the parent byte for byte\n")
+    return True
+
+
+if __name__ == '__main__':
+    success = True
+    
+    # Run tests
+    success &= test_basic_functionality()
+    success &= test_action_mapping()
+    success &= test_native_reward()
+    success &= test_fork_reuse()
+    
+    # Exit code
+    sys.exit(0 if success else 1)
@@ -1,194 +1,816 @@
-#include "python_api.h"
-#include "types.h"
-#include "rom_loader.h"
-#include "memory.h"
-#include "cpu_core.h"
-#include "gfx_renderer.h"
-#include "input.h"
-#include "interrupts.h"
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-// Internal emulator state (not exposed to Python)
-typedef struct {
-    ARM7TDMI cpu;
-    Memory memory;
-    GFXState gfx;
-    InputState input;
-    InterruptState interrupts;
-    u8 *rom_data;
-    u32 rom_size;
-    u64 frame_count;
-} EmulatorState;
-
-EmuHandle emu_init(const char *rom_path) {
-    if (!rom_path) return NULL;
-    
-    // Allocate emulator state
-    EmulatorState *emu = (EmulatorState*)malloc(sizeof(EmulatorState));
-    if (!emu) return NULL;
-    
-    memset(emu, 0, sizeof(EmulatorState));
-    
-    // Load ROM
-    if (!load_rom(rom_path, &emu->rom_data, &emu->rom_size)) {
-        free(emu);
-        return NULL;
-    }
-    
-    // Initialize subsystems
-    cpu_init(&emu->cpu);
-    mem_init(&emu->memory);
-    mem_set_rom(&emu->memory, emu->rom_data, emu->rom_size);
-    interrupt_init(&emu->interrupts);
-    mem_set_interrupts(&emu->memory, &emu->interrupts);
-    gfx_init(&emu->gfx);
-    input_init(&emu->input);
-    
-    cpu_reset(&emu->cpu);
-    
-    emu->frame_count = 0;
-    
-    printf("Python API: Emulator initialized (ROM: %u bytes)\n", emu->rom_size);
-    
-    return (EmuHandle)emu;
-}
-
-void emu_step(EmuHandle handle, u8 buttons) {
-    if (!handle) return;
-    
-    EmulatorState *emu = (EmulatorState*)handle;
-    
-    // Set button input
-    mem_set_ai_input(&emu->memory, buttons);
-    input_update(&emu->input, &emu->memory);
-    
-    // Clear VBlank at start of frame (back to scanline 0)
-    interrupt_update_vcount(&emu->interrupts, 0);
-    
-    // Execute one frame (game code runs)
-    cpu_execute_frame(&emu->cpu, &emu->memory, &emu->interrupts);
-    
-    // Trigger VBlank interrupt at END of frame (scanline 160)
-    // This will be processed at the START of next frame's execution
-    interrupt_update_vcount(&emu->interrupts, 160);
-    
-    // Render graphics
-    gfx_render_frame(&emu->gfx, &emu->memory);
-    
-    emu->frame_count++;
-}
-
-void emu_get_screen(EmuHandle handle, u8 *buffer) {
-    if (!handle || !buffer) return;
-    
-    EmulatorState *emu = (EmulatorState*)handle;
-    
-    // Convert RGB565 framebuffer to RGB888
-    u16 *fb = emu->gfx.framebuffer;
-    
-    for (int y = 0; y < GBA_SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < GBA_SCREEN_WIDTH; x++) {
-            u16 color = fb[y * GBA_SCREEN_WIDTH + x];
-            
-            // RGB565 -> RGB888
-            u8 r = ((color >> 11) & 0x1F) << 3;
-            u8 g = ((color >> 5) & 0x3F) << 2;
-            u8 b = (color & 0x1F) << 3;
-            
-            int idx = (y * GBA_SCREEN_WIDTH + x) * 3;
-            buffer[idx + 0] = r;
-            buffer[idx + 1] = g;
-            buffer[idx + 2] = b;
-        }
-    }
-}
-
-void emu_reset(EmuHandle handle) {
-    if (!handle) return;
-    
-    EmulatorState *emu = (EmulatorState*)handle;
-    
-    // Reset CPU
-    cpu_reset(&emu->cpu);
-    
-    // Clear memory (except ROM)
-    memset(emu->memory.ewram, 0, EWRAM_SIZE);
-    memset(emu->memory.iwram, 0, IWRAM_SIZE);
-    memset(emu->memory.io_regs, 0, IO_SIZE);
-    memset(emu->memory.palette, 0, PALETTE_SIZE);
-    memset(emu->memory.vram, 0, VRAM_SIZE);
-    memset(emu->memory.oam, 0, OAM_SIZE);
-    
-    // Reset interrupts
-    interrupt_init(&emu->interrupts);
-    
-    // Reset graphics
-    memset(emu->gfx.framebuffer, 0, sizeof(emu->gfx.framebuffer));
-    
-    emu->frame_count = 0;
-    
-    printf("Python API: Emulator reset\n");
-}
-
-void emu_cleanup(EmuHandle handle) {
-    if (!handle) return;
-    
-    EmulatorState *emu = (EmulatorState*)handle;
-    
-    // Free ROM data
-    if (emu->rom_data) {
-        free(emu->rom_data);
-    }
-    
-    // Cleanup memory system
-    mem_cleanup(&emu->memory);
-    
-    // Free emulator state
-    free(emu);
-    
-    printf("Python API: Emulator cleaned up\n");
-}
-
-u8 emu_read_memory(EmuHandle handle, u32 addr) {
-    if (!handle) return 0;
-    
-    EmulatorState *emu = (EmulatorState*)handle;
-    return mem_read8(&emu->memory, addr);
-}
-
-void emu_write_memory(EmuHandle handle, u32 addr, u8 value) {
-    if (!handle) return;
-    
-    EmulatorState *emu = (EmulatorState*)handle;
-    mem_write8(&emu->memory, addr, value);
-}
-
-u32 emu_get_frame_count(EmuHandle handle) {
-    if (!handle) return 0;
-    
-    EmulatorState *emu = (EmulatorState*)handle;
-    return (u32)emu->frame_count;
-}
-
-u32 emu_get_cpu_cycles(EmuHandle handle) {
-    if (!handle) return 0;
-    
-    EmulatorState *emu = (EmulatorState*)handle;
-    return (u32)emu->cpu.cycles;
-}
-
-void emu_save_state(EmuHandle handle, const char *filename) {
-    if (!handle || !filename) return;
-    
-    // TODO: Implement save state functionality
-    printf("Python API: Save state not yet implemented\n");
-}
-
-void emu_load_state(EmuHandle handle, const char *filename) {
-    if (!handle || !filename) return;
-    
-    // TODO: Implement load state functionality
-    printf("Python API: Load state not yet implemented\n");
-}
+#include "python_api.h"
+#include "types.h"
+#include "emulator.h"
+#include "save_state.h"
+#include "rom_loader.h"
+#include "aot.h"
+#include "thread_pool.h"
+#include "page_store.h"
+#include "game_state.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void emu_update_screen(EmulatorState *emu);
+static void emu_render(EmulatorState *emu);
+
+// Build an emulator around an already loaded ROM
+static EmulatorState *emu_create(u8 *rom_data, u32 rom_size, bool owns_rom, u32 flags) {
+    // Allocate emulator state
+    EmulatorState *emu = (EmulatorState*)malloc(sizeof(EmulatorState));
+    if (!emu) return NULL;
+    
+    memset(emu, 0, sizeof(EmulatorState));
+    emu->rom_data = rom_data;
+    emu->rom_size = rom_size;
+    emu->owns_rom = owns_rom;
+    
+    // Initialize subsystems (all guest state lives in one arena)
+    emu->guest = guest_create();
+    if (!emu->guest) {
+        free(emu);
+        return NULL;
+    }
+    mem_set_rom(&emu->guest->memory, emu->rom_data, emu->rom_size);
+    emu->block_cache = block_cache_create();
+    mem_set_block_cache(&emu->guest->memory, emu->block_cache);
+    if (flags & EMU_INIT_JIT) {
+        emu->jit = jit_create();
+        if (!emu->jit) {
+            printf("Python API: JIT not available on this host, using interpreter\n");
+        }
+        mem_set_jit(&emu->guest->memory, emu->jit);
+    }
+    if (!(flags & EMU_INIT_NO_AOT)) {
+        mem_set_aot(&emu->guest->memory, aot_program_for_rom(emu->rom_data, emu->rom_size));
+    }
+    
+    cpu_reset(&emu->guest->cpu);
+    
+    emu->screen_format = EMU_SCREEN_RGB888;
+    emu->render_policy = EMU_RENDER_ALWAYS;
+    emu->render_interval = 1;
+    emu_update_screen(emu);
+    
+    printf("Python API: Emulator initialized (ROM: %u bytes)\n", emu->rom_size);
+    
+    return emu;
+}
+
+EmuHandle emu_init(const char *rom_path) {
+    return emu_init_ex(rom_path, 0);
+}
+
+EmuHandle emu_init_ex(const char *rom_path, u32 flags) {
+    if (!rom_path) return NULL;
+    
+    // Load ROM
+    u8 *rom_data;
+    u32 rom_size;
+    if (!load_rom(rom_path, &rom_data, &rom_size)) {
+        return NULL;
+    }
+    
+    EmulatorState *emu = emu_create(rom_data, rom_size, true, flags);
+    if (!emu) {
+        free(rom_data);
+        return NULL;
+    }
+    return (EmuHandle)emu;
+}
+
+// Run one frame of game code with the given buttons held
+static void emu_run_frame(EmulatorState *emu, u8 buttons) {
+    GuestState *guest = emu->guest;
+    
+    // Set button input
+    mem_set_ai_input(&guest->memory, buttons);
+    input_update(&guest->input, &guest->memory);
+    
+    // Execute one frame (game code runs; the scheduler drives display
+    // timing, timers, DMA and the RTC)
+    cpu_execute_frame(&guest->cpu, &guest->memory, &guest->interrupts);
+    
+    guest->frame_count++;
+    emu->pool_pending = false;  // A pooled screen belongs to the previous frame
+}
+
+// Whether the policy shows the frame ending at frame_count, now or (lazy)
+// on request
+static bool emu_shows_frame(const EmulatorState *emu, u32 frame_count) {
+    switch (emu->render_policy) {
+        case EMU_RENDER_NEVER:   return false;
+        case EMU_RENDER_EVERY_N: return frame_count % emu->render_interval == 0;
+        default:                 return true;
+    }
+}
+
+// Render graphics and refresh the zero-copy screen view, unless the
+// policy skips or defers this frame
+static void emu_present(EmulatorState *emu) {
+    if (!emu_shows_frame(emu, emu->guest->frame_count)) return;
+    if (emu->render_policy == EMU_RENDER_LAZY) {
+        emu->screen_stale = true;
+    } else {
+        emu_render(emu);
+    }
+}
+
+void emu_step(EmuHandle handle, u8 buttons) {
+    if (!handle) return;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    emu_run_frame(emu, buttons);
+    emu_present(emu);
+    
+    if (emu->rewind) rewind_push(emu->rewind, (const u8*)emu->guest);
+}
+
+// Per-channel maximum of two RGB565 frames, into fb
+static void emu_max_pool(u16 *fb, const u16 *other) {
+    for (int i = 0; i < GBA_FRAMEBUFFER_SIZE; i++) {
+        u16 a = fb[i];
+        u16 b = other[i];
+        u16 r = (a & 0xF800) > (b & 0xF800) ? (a & 0xF800) : (b & 0xF800);
+        u16 g = (a & 0x07E0) > (b & 0x07E0) ? (a & 0x07E0) : (b & 0x07E0);
+        u16 bl = (a & 0x001F) > (b & 0x001F) ? (a & 0x001F) : (b & 0x001F);
+        fb[i] = r | g | bl;
+    }
+}
+
+float emu_step_n(EmuHandle handle, u8 buttons, u32 n, u32 flags) {
+    if (!handle) return 0.0f;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    GuestState *guest = emu->guest;
+    // The next-to-last frame is only drawn if the policy shows the last one
+    bool pool = (flags & EMU_STEP_MAX_POOL) && n >= 2 && emu_shows_frame(emu, guest->frame_count + n);
+    float reward = 0.0f;
+    
+    for (u32 i = 0; i < n; i++) {
+        emu_run_frame(emu, buttons);
+        if (flags & EMU_STEP_REWARD) {
+            reward += game_reward(&guest->memory, &emu->reward);
+        }
+        
+        // Only the frames the agent sees are drawn
+        if (i + 1 < n) {
+            if (pool && i + 2 == n) {
+                gfx_render_frame(&guest->gfx, &guest->memory);
+                memcpy(emu->pool_frame, guest->framebuffer, sizeof(emu->pool_frame));
+            }
+        } else {
+            emu->pool_pending = pool;  // emu_render pools it, now or on request
+            emu_present(emu);
+        }
+        
+        if (emu->rewind) rewind_push(emu->rewind, (const u8*)guest);
+    }
+    return reward;
+}
+
+// Convert the RGB565 framebuffer to RGB888
+static void emu_convert_rgb888(const u16 *fb, u8 *buffer) {
+    for (int i = 0; i < GBA_FRAMEBUFFER_SIZE; i++) {
+        u16 color = fb[i];
+        
+        // RGB565 -> RGB888
+        buffer[i * 3 + 0] = ((color >> 11) & 0x1F) << 3;
+        buffer[i * 3 + 1] = ((color >> 5) & 0x3F) << 2;
+        buffer[i * 3 + 2] = (color & 0x1F) << 3;
+    }
+}
+
+// Convert the RGB565 framebuffer to 8-bit luminance (BT.601 weights)
+static void emu_convert_gray8(const u16 *fb, u8 *buffer) {
+    for (int i = 0; i < GBA_FRAMEBUFFER_SIZE; i++) {
+        u16 color = fb[i];
+        u32 r = ((color >> 11) & 0x1F) << 3;
+        u32 g = ((color >> 5) & 0x3F) << 2;
+        u32 b = (color & 0x1F) << 3;
+        buffer[i] = (u8)((r * 77 + g * 150 + b * 29) >> 8);
+    }
+}
+
+// Bring emu->screen up to date with the framebuffer
+static void emu_update_screen(EmulatorState *emu) {
+    switch (emu->screen_format) {
+        case EMU_SCREEN_RGB888: emu_convert_rgb888(emu->guest->framebuffer, emu->screen); break;
+        case EMU_SCREEN_GRAY8:  emu_convert_gray8(emu->guest->framebuffer, emu->screen); break;
+        default: break;       // RGB565 is the framebuffer itself
+    }
+}
+
+// Draw the frame from the current memory and I/O registers
+static void emu_render(EmulatorState *emu) {
+    gfx_render_frame(&emu->guest->gfx, &emu->guest->memory);
+    if (emu->pool_pending) {
+        emu_max_pool(emu->guest->framebuffer, emu->pool_frame);
+        emu->pool_pending = false;
+    }
+    emu_update_screen(emu);
+    emu->screen_stale = false;
+}
+
+// Lazy rendering: the frame ended at VBlank and nothing ran since, so
+// rendering now gives the image emu_step would have drawn
+static void emu_refresh_screen(EmulatorState *emu) {
+    if (emu->screen_stale) emu_render(emu);
+}
+
+void emu_get_screen(EmuHandle handle, u8 *buffer) {
+    if (!handle || !buffer) return;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    emu_refresh_screen(emu);
+    if (emu->screen_format == EMU_SCREEN_RGB888) {
+        memcpy(buffer, emu->screen, EMU_SCREEN_BYTES);
+    } else {
+        emu_convert_rgb888(emu->guest->framebuffer, buffer);
+    }
+}
+
+void emu_set_screen_format(EmuHandle handle, u32 format) {
+    if (!handle) return;
+    if (format != EMU_SCREEN_RGB888 && format != EMU_SCREEN_RGB565 && format != EMU_SCREEN_GRAY8) return;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    emu->screen_format = format;
+    if (!emu->screen_stale) emu_update_screen(emu);
+}
+
+void emu_set_render_policy(EmuHandle handle, u32 policy, u32 interval) {
+    if (!handle || policy > EMU_RENDER_LAZY) return;
+    
+    // Settle a deferred frame before leaving lazy mode
+    EmulatorState *emu = (EmulatorState*)handle;
+    emu_refresh_screen(emu);
+    emu->render_policy = policy;
+    emu->render_interval = interval ? interval : 1;
+}
+
+const u8 *emu_get_screen_ptr(EmuHandle handle) {
+    if (!handle) return NULL;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    emu_refresh_screen(emu);
+    if (emu->screen_format == EMU_SCREEN_RGB565) {
+        return (const u8*)emu->guest->framebuffer;
+    }
+    return emu->screen;
+}
+
+u32 emu_get_screen_size(EmuHandle handle) {
+    if (!handle) return 0;
+    
+    switch (((EmulatorState*)handle)->screen_format) {
+        case EMU_SCREEN_RGB565: return GBA_FRAMEBUFFER_SIZE * sizeof(u16);
+        case EMU_SCREEN_GRAY8:  return GBA_FRAMEBUFFER_SIZE;
+        default:                return EMU_SCREEN_BYTES;
+    }
+}
+
+u8 *emu_get_memory_ptr(EmuHandle handle, u32 region, u32 *size) {
+    u8 *ptr = NULL;
+    u32 bytes = 0;
+    
+    if (handle) {
+        Memory *mem = &((EmulatorState*)handle)->guest->memory;
+        switch (region) {
+            case EMU_MEM_EWRAM:   ptr = mem->ewram;   bytes = EWRAM_SIZE;   break;
+            case EMU_MEM_IWRAM:   ptr = mem->iwram;   bytes = IWRAM_SIZE;   break;
+            case EMU_MEM_VRAM:    ptr = mem->vram;    bytes = VRAM_SIZE;    break;
+            case EMU_MEM_OAM:     ptr = mem->oam;     bytes = OAM_SIZE;     break;
+            case EMU_MEM_PALETTE: ptr = mem->palette; bytes = PALETTE_SIZE; break;
+            case EMU_MEM_SRAM:    ptr = mem->sram;    bytes = sizeof(mem->sram); break;
+            default: break;
+        }
+    }
+    
+    if (size) *size = bytes;
+    return ptr;
+}
+
+// EMU_MEM_* ids follow MemArea order
+_Static_assert(EMU_MEM_SRAM == MEM_AREA_SRAM, "EMU_MEM_* and MemArea disagree");
+_Static_assert(EMU_PAGE_SIZE == MEM_PAGE_SIZE, "EMU_PAGE_SIZE and MEM_PAGE_SIZE disagree");
+
+u32 emu_get_dirty_pages(EmuHandle handle, u32 region, u32 *pages, u32 max) {
+    if (!handle || region >= MEM_AREA_COUNT) return 0;
+    
+    const Memory *mem = &((EmulatorState*)handle)->guest->memory;
+    u32 first, count;
+    mem_area_pages((MemArea)region, &first, &count);
+    
+    u32 found = 0;
+    for (u32 i = 0; i < count; i++) {
+        if (!mem_page_dirty(mem, MEM_DIRTY_USER, first + i)) continue;
+        if (pages && found < max) pages[found] = i;
+        found++;
+    }
+    return found;
+}
+
+void emu_clear_dirty(EmuHandle handle) {
+    if (!handle) return;
+    mem_clear_dirty(&((EmulatorState*)handle)->guest->memory, MEM_DIRTY_USER);
+}
+
+// Start the rewind history over at the current state (after a jump the
+// recorded frames belong to another timeline)
+static void emu_rewind_restart(EmulatorState *emu) {
+    if (!emu->rewind) return;
+    rewind_clear(emu->rewind);
+    rewind_push(emu->rewind, (const u8*)emu->guest);
+}
+
+void emu_reset(EmuHandle handle) {
+    if (!handle) return;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    GuestState *guest = emu->guest;
+    
+    // Reset CPU
+    cpu_reset(&guest->cpu);
+    
+    // Clear memory (except ROM)
+    memset(guest->memory.ewram, 0, EWRAM_SIZE);
+    memset(guest->memory.iwram, 0, IWRAM_SIZE);
+    memset(guest->memory.io_regs, 0, IO_SIZE);
+    memset(guest->memory.palette, 0, PALETTE_SIZE);
+    memset(guest->memory.vram, 0, VRAM_SIZE);
+    memset(guest->memory.oam, 0, OAM_SIZE);
+    
+    // Cached RAM code was just wiped
+    block_cache_flush(emu->block_cache);
+    mem_mark_all_dirty(&guest->memory);
+    
+    // Reset interrupts, timers, DMA and display timing
+    interrupt_init(&guest->interrupts);
+    timer_init(&guest->timers);
+    dma_init(&guest->dma);
+    scheduler_init(&guest->scheduler);
+    
+    // Reset graphics
+    memset(guest->framebuffer, 0, sizeof(guest->framebuffer));
+    emu_update_screen(emu);
+    emu->screen_stale = false;
+    emu->pool_pending = false;
+    
+    guest->frame_count = 0;
+    memset(&emu->reward, 0, sizeof(emu->reward));
+    emu_rewind_restart(emu);
+    
+    printf("Python API: Emulator reset\n");
+}
+
+// Free an instance and every fork it owns
+static void emu_destroy(EmulatorState *emu) {
+    EmulatorState *child = emu->fork_children;
+    while (child) {
+        EmulatorState *next = child->fork_next;
+        emu_destroy(child);
+        child = next;
+    }
+    
+    // Free ROM data (a batch frees its shared copy itself)
+    if (emu->rom_data && emu->owns_rom) {
+        free(emu->rom_data);
+    }
+    
+    rewind_destroy(emu->rewind);
+    free(emu->rewind_state);
+    
+    // Cleanup memory system
+    guest_destroy(emu->guest);
+    block_cache_destroy(emu->block_cache);
+    jit_destroy(emu->jit);
+    
+    // Free emulator state
+    free(emu);
+}
+
+void emu_cleanup(EmuHandle handle) {
+    if (!handle) return;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    
+    // A fork goes back to its parent; remember what it wrote since the fork
+    if (emu->fork_parent) {
+        u64 written[MEM_DIRTY_WORDS];
+        mem_dirty_bits(&emu->guest->memory, MEM_DIRTY_SYNC, written);
+        for (u32 w = 0; w < MEM_DIRTY_WORDS; w++) {
+            emu->fork_stale[w] |= written[w];
+        }
+        emu->fork_idle = true;
+        return;
+    }
+    
+    emu_destroy(emu);
+    
+    printf("Python API: Emulator cleaned up\n");
+}
+
+u8 emu_read_memory(EmuHandle handle, u32 addr) {
+    if (!handle) return 0;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    return mem_read8(&emu->guest->memory, addr);
+}
+
+void emu_write_memory(EmuHandle handle, u32 addr, u8 value) {
+    if (!handle) return;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    mem_write8(&emu->guest->memory, addr, value);
+}
+
+u32 emu_get_frame_count(EmuHandle handle) {
+    if (!handle) return 0;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    return (u32)emu->guest->frame_count;
+}
+
+u32 emu_get_cpu_cycles(EmuHandle handle) {
+    if (!handle) return 0;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    return (u32)emu->guest->cpu.cycles;
+}
+
+bool emu_save_state(EmuHandle handle, const char *filename) {
+    if (!handle || !filename) return false;
+    
+    if (!save_state_to_file((EmulatorState*)handle, filename)) {
+        printf("Python API: Failed to save state to %s\n", filename);
+        return false;
+    }
+    return true;
+}
+
+// Code caches and the screen view are derived from the restored state. A
+// state saved by a lazy instance may carry an old framebuffer, so lazy
+// instances draw the restored frame on request.
+static void emu_after_load(EmulatorState *emu) {
+    block_cache_flush(emu->block_cache);
+    emu->pool_pending = false;
+    if (emu->render_policy == EMU_RENDER_LAZY) {
+        emu->screen_stale = true;
+    } else {
+        emu_update_screen(emu);
+    }
+}
+
+bool emu_load_state(EmuHandle handle, const char *filename) {
+    if (!handle || !filename) return false;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    if (!load_state_from_file(emu, filename)) {
+        printf("Python API: Failed to load state from %s\n", filename);
+        return false;
+    }
+    emu_after_load(emu);
+    emu_rewind_restart(emu);
+    return true;
+}
+
+u32 emu_snapshot_size(void) {
+    return get_save_state_size();
+}
+
+bool emu_snapshot(EmuHandle handle, u8 *buffer) {
+    if (!handle || !buffer) return false;
+    
+    u32 size = get_save_state_size();
+    return save_state_to_buffer((EmulatorState*)handle, buffer, &size);
+}
+
+bool emu_restore(EmuHandle handle, const u8 *buffer) {
+    if (!handle || !buffer) return false;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    if (!load_state_from_buffer(emu, buffer, get_save_state_size())) return false;
+    emu_after_load(emu);
+    emu_rewind_restart(emu);
+    return true;
+}
+
+// Forks
+
+EmuHandle emu_fork(EmuHandle handle) {
+    if (!handle) return NULL;
+    
+    EmulatorState *parent = (EmulatorState*)handle;
+    
+    // What the parent wrote since its last fork is stale in every child
+    u64 changed[MEM_DIRTY_WORDS];
+    mem_dirty_bits(&parent->guest->memory, MEM_DIRTY_FORK, changed);
+    mem_clear_dirty(&parent->guest->memory, MEM_DIRTY_FORK);
+    
+    EmulatorState *child = NULL;
+    for (EmulatorState *c = parent->fork_children; c; c = c->fork_next) {
+        for (u32 w = 0; w < MEM_DIRTY_WORDS; w++) {
+            c->fork_stale[w] |= changed[w];
+        }
+        if (!child && c->fork_idle) child = c;
+    }
+    
+    if (!child) {
+        // Same ROM, code caches of its own; the AOT program is read-only
+        u32 flags = EMU_INIT_NO_AOT | (parent->jit ? EMU_INIT_JIT : 0);
+        child = emu_create(parent->rom_data, parent->rom_size, false, flags);
+        if (!child) return NULL;
+        mem_set_aot(&child->guest->memory, parent->guest->memory.aot);
+        
+        memset(child->fork_stale, 0xFF, sizeof(child->fork_stale));
+        child->fork_parent = parent;
+        child->fork_next = parent->fork_children;
+        parent->fork_children = child;
+    }
+    
+    guest_sync(child->guest, parent->guest, child->fork_stale);
+    
+    // The child's own forks lag behind by what it wrote since it last forked
+    // and by the pages just copied
+    if (child->fork_children) {
+        u64 moved[MEM_DIRTY_WORDS];
+        mem_dirty_bits(&child->guest->memory, MEM_DIRTY_FORK, moved);
+        for (EmulatorState *c = child->fork_children; c; c = c->fork_next) {
+            for (u32 w = 0; w < MEM_DIRTY_WORDS; w++) {
+                c->fork_stale[w] |= moved[w] | child->fork_stale[w];
+            }
+        }
+    }
+    memset(child->fork_stale, 0, sizeof(child->fork_stale));
+    child->fork_idle = false;
+    
+    // A fresh instance to the caller (every page dirty) with nothing pending
+    // for the fork bookkeeping
+    mem_mark_all_dirty(&child->guest->memory);
+    mem_clear_dirty(&child->guest->memory, MEM_DIRTY_SYNC);
+    mem_clear_dirty(&child->guest->memory, MEM_DIRTY_FORK);
+    
+    // A recycled fork's history belongs to another branch
+    emu_rewind_restart(child);
+    
+    child->screen_format = parent->screen_format;
+    child->render_policy = parent->render_policy;
+    child->render_interval = parent->render_interval;
+    child->screen_stale = parent->screen_stale;
+    child->pool_pending = parent->pool_pending;
+    if (child->pool_pending) {
+        memcpy(child->pool_frame, parent->pool_frame, sizeof(child->pool_frame));
+    }
+    child->reward = parent->reward;
+    if (!child->screen_stale && parent->screen_format != EMU_SCREEN_RGB565) {
+        memcpy(child->screen, parent->screen, emu_get_screen_size(parent));
+    }
+    
+    return (EmuHandle)child;
+}
+
+// Rewind
+
+bool emu_rewind_enable(EmuHandle handle, u32 keyframe_interval, u32 max_bytes) {
+    if (!handle) return false;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    rewind_destroy(emu->rewind);
+    free(emu->rewind_state);
+    emu->rewind = NULL;
+    emu->rewind_state = NULL;
+    if (max_bytes == 0) return true;
+    
+    // The arena starts with the bytes guest_save would copy
+    emu->rewind = rewind_create(GUEST_STATE_BYTES, keyframe_interval, max_bytes);
+    emu->rewind_state = (u8*)malloc(GUEST_STATE_BYTES);
+    if (!emu->rewind || !emu->rewind_state) {
+        emu_rewind_enable(handle, 0, 0);
+        return false;
+    }
+    rewind_push(emu->rewind, (const u8*)emu->guest);
+    return true;
+}
+
+u32 emu_rewind(EmuHandle handle, u32 frames) {
+    if (!handle) return 0;
+    
+    EmulatorState *emu = (EmulatorState*)handle;
+    u32 depth = rewind_depth(emu->rewind);
+    if (frames > depth) frames = depth;
+    if (frames == 0 || !rewind_seek(emu->rewind, frames, emu->rewind_state)) return 0;
+    
+    guest_load(emu->guest, emu->rewind_state);
+    emu_after_load(emu);
+    return frames;
+}
+
+u32 emu_rewind_depth(EmuHandle handle) {
+    return handle ? rewind_depth(((EmulatorState*)handle)->rewind) : 0;
+}
+
+// Snapshot store
+
+typedef struct {
+    PageStore *pages;
+    u8 *scratch;          // One state, assembled for guest_load
+} EmuStore;
+
+EmuStoreHandle emu_store_create(u64 max_bytes) {
+    EmuStore *store = (EmuStore*)calloc(1, sizeof(EmuStore));
+    if (!store) return NULL;
+    
+    store->pages = page_store_create(GUEST_STATE_BYTES, EMU_STORE_PAGE_SIZE, max_bytes);
+    store->scratch = (u8*)malloc(GUEST_STATE_BYTES);
+    if (!store->pages || !store->scratch) {
+        emu_store_destroy(store);
+        return NULL;
+    }
+    return (EmuStoreHandle)store;
+}
+
+void emu_store_destroy(EmuStoreHandle handle) {
+    if (!handle) return;
+    
+    EmuStore *store = (EmuStore*)handle;
+    page_store_destroy(store->pages);
+    free(store->scratch);
+    free(store);
+}
+
+u64 emu_store_put(EmuStoreHandle handle, EmuHandle emu) {
+    if (!handle || !emu) return 0;
+    
+    // The arena starts with the bytes guest_save would copy; hash them in place
+    const GuestState *guest = ((EmulatorState*)emu)->guest;
+    return page_store_put(((EmuStore*)handle)->pages, (const u8*)guest);
+}
+
+bool emu_store_restore(EmuStoreHandle handle, EmuHandle emu, u64 id) {
+    if (!handle || !emu) return false;
+    
+    EmuStore *store = (EmuStore*)handle;
+    if (!page_store_get(store->pages, id, store->scratch)) return false;
+    
+    EmulatorState *state = (EmulatorState*)emu;
+    guest_load(state->guest, store->scratch);
+    emu_after_load(state);
+    emu_rewind_restart(state);
+    return true;
+}
+
+bool emu_store_evict(EmuStoreHandle handle, u64 id) {
+    return handle ? page_store_evict(((EmuStore*)handle)->pages, id) : false;
+}
+
+u32 emu_store_count(EmuStoreHandle handle) {
+    return handle ? page_store_states(((EmuStore*)handle)->pages) : 0;
+}
+
+u64 emu_store_bytes(EmuStoreHandle handle) {
+    return handle ? page_store_bytes(((EmuStore*)handle)->pages) : 0;
+}
+
+// Batched environments
+
+typedef struct {
+    u32 count;
+    EmulatorState **emus;
+    ThreadPool *pool;
+    u8 *rom_data;         // One ROM image shared (read-only) by every instance
+    const u8 *actions;    // Buttons for the step in progress
+    u32 frames;           // Frames per step and emu_step_n flags for the step in progress
+    u32 step_flags;
+    float *rewards;       // Destination of the step's rewards (NULL = drop them)
+    u8 *obs;              // Destination of the observation copy in progress
+} EmuBatch;
+
+EmuBatchHandle emu_batch_create(u32 count, const char *rom_path) {
+    return emu_batch_create_ex(count, rom_path, 0, 0);
+}
+
+EmuBatchHandle emu_batch_create_ex(u32 count, const char *rom_path, u32 flags, u32 threads) {
+    if (!rom_path || count == 0) return NULL;
+    
+    EmuBatch *batch = (EmuBatch*)calloc(1, sizeof(EmuBatch));
+    if (!batch) return NULL;
+    batch->emus = (EmulatorState**)calloc(count, sizeof(EmulatorState*));
+    
+    u32 rom_size;
+    if (!batch->emus || !load_rom(rom_path, &batch->rom_data, &rom_size)) {
+        free(batch->emus);
+        free(batch);
+        return NULL;
+    }
+    
+    for (u32 i = 0; i < count; i++) {
+        batch->emus[i] = emu_create(batch->rom_data, rom_size, false, flags);
+        if (!batch->emus[i]) {
+            emu_batch_destroy(batch);
+            return NULL;
+        }
+        batch->count++;
+    }
+    
+    // No point in more threads than instances
+    if (threads == 0) threads = thread_pool_cpu_count();
+    if (threads > count) threads = count;
+    batch->pool = thread_pool_create(threads);
+    
+    printf("Python API: Batch of %u emulators on %u threads\n", count, thread_pool_size(batch->pool));
+    
+    return (EmuBatchHandle)batch;
+}
+
+static void emu_batch_step_task(void *context, u32 index) {
+    EmuBatch *batch = (EmuBatch*)context;
+    EmuHandle emu = (EmuHandle)batch->emus[index];
+    if (batch->frames == 1 && batch->step_flags == 0) {
+        emu_step(emu, batch->actions[index]);
+        return;
+    }
+    
+    float reward = emu_step_n(emu, batch->actions[index], batch->frames, batch->step_flags);
+    if (batch->rewards) batch->rewards[index] = reward;
+}
+
+void emu_batch_step(EmuBatchHandle handle, const u8 *actions, u32 count) {
+    emu_batch_step_n(handle, actions, count, 1, 0, NULL);
+}
+
+void emu_batch_step_n(EmuBatchHandle handle, const u8 *actions, u32 count, u32 n, u32 flags,
+                      float *rewards) {
+    if (!handle || !actions) return;
+    
+    EmuBatch *batch = (EmuBatch*)handle;
+    if (count > batch->count) count = batch->count;
+    
+    batch->actions = actions;
+    batch->frames = n;
+    batch->step_flags = flags;
+    batch->rewards = rewards;
+    thread_pool_run(batch->pool, emu_batch_step_task, batch, count);
+    batch->actions = NULL;
+    batch->rewards = NULL;
+}
+
+void emu_batch_set_screen_format(EmuBatchHandle handle, u32 format) {
+    if (!handle) return;
+    
+    EmuBatch *batch = (EmuBatch*)handle;
+    for (u32 i = 0; i < batch->count; i++) {
+        emu_set_screen_format((EmuHandle)batch->emus[i], format);
+    }
+}
+
+void emu_batch_set_render_policy(EmuBatchHandle handle, u32 policy, u32 interval) {
+    if (!handle) return;
+    
+    EmuBatch *batch = (EmuBatch*)handle;
+    for (u32 i = 0; i < batch->count; i++) {
+        emu_set_render_policy((EmuHandle)batch->emus[i], policy, interval);
+    }
+}
+
+// Screens are already converted by emu_step, this is a plain copy (lazy
+// instances render here, in parallel)
+static void emu_batch_obs_task(void *context, u32 index) {
+    EmuBatch *batch = (EmuBatch*)context;
+    EmuHandle emu = (EmuHandle)batch->emus[index];
+    u32 size = emu_get_screen_size(emu);
+    memcpy(batch->obs + (size_t)index * size, emu_get_screen_ptr(emu), size);
+}
+
+void emu_batch_get_obs(EmuBatchHandle handle, u8 *out) {
+    if (!handle || !out) return;
+    
+    EmuBatch *batch = (EmuBatch*)handle;
+    batch->obs = out;
+    thread_pool_run(batch->pool, emu_batch_obs_task, batch, batch->count);
+    batch->obs = NULL;
+}
+
+EmuHandle emu_batch_get(EmuBatchHandle handle, u32 index) {
+    if (!handle) return NULL;
+    
+    EmuBatch *batch = (EmuBatch*)handle;
+    return index < batch->count ? (EmuHandle)batch->emus[index] : NULL;
+}
+
+u32 emu_batch_size(EmuBatchHandle handle) {
+    return handle ? ((EmuBatch*)handle)->count : 0;
+}
+
+void emu_batch_destroy(EmuBatchHandle handle) {
+    if (!handle) return;
+    
+    EmuBatch *batch = (EmuBatch*)handle;
+    thread_pool_destroy(batch->pool);
+    for (u32 i = 0; i < batch->count; i++) {
+        emu_cleanup((EmuHandle)batch->emus[i]);
+    }
+    free(batch->emus);
+    free(batch->rom_data);
+    free(batch);
+}
@@ -1,44 +1,236 @@
-#ifndef PYTHON_API_H
-#define PYTHON_API_H
-
-#include "types.h"
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-// Opaque emulator state for Python
-typedef void* EmuHandle;
-
-// Initialize emulator with ROM
-EmuHandle emu_init(const char *rom_path);
-
-// Execute one frame with given button input
-void emu_step(EmuHandle handle, u8 buttons);
-
-// Get current screen buffer (240x160 RGB888)
-void emu_get_screen(EmuHandle handle, u8 *buffer);
-
-// Reset emulator to initial state
-void emu_reset(EmuHandle handle);
-
-// Cleanup and free emulator
-void emu_cleanup(EmuHandle handle);
-
-// Memory access
-u8 emu_read_memory(EmuHandle handle, u32 addr);
-void emu_write_memory(EmuHandle handle, u32 addr, u8 value);
-
-// Get emulator statistics
-u32 emu_get_frame_count(EmuHandle handle);
-u32 emu_get_cpu_cycles(EmuHandle handle);
-
-// Save state management
-void emu_save_state(EmuHandle handle, const char *filename);
-void emu_load_state(EmuHandle handle, const char *filename);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif // PYTHON_API_H
+#ifndef PYTHON_API_H
+#define PYTHON_API_H
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Opaque emulator state for Python
+typedef void* EmuHandle;
+
+// Initialize emulator with ROM
+EmuHandle emu_init(const char *rom_path);
+
+// emu_init flags
+#define EMU_INIT_JIT     (1 << 0)  // Experimental x86-64 recompiler for Thumb ROM code
+#define EMU_INIT_NO_AOT  (1 << 1)  // Ignore code translated at build time (EMERALD_AOT_ROM)
+
+// Initialize emulator with ROM and EMU_INIT_* flags
+EmuHandle emu_init_ex(const char *rom_path, u32 flags);
+
+// Execute one frame with given button input
+void emu_step(EmuHandle handle, u8 buttons);
+
+// emu_step_n flags
+#define EMU_STEP_MAX_POOL  (1 << 0)  // Screen = per-channel max of the last two frames
+#define EMU_STEP_REWARD    (1 << 1)  // Sum the native reward over the n frames
+
+// Execute n frames with the same buttons held (action repeat) in one call.
+// Only the last frame is rendered, as the render policy says; with
+// EMU_STEP_MAX_POOL the screen is the pool of the last two, which hides
+// sprites that flicker every other frame. The next-to-last frame is then
+// drawn during the call if the policy shows the last one (under
+// EMU_RENDER_LAZY the last frame and the pool wait for the request). With
+// EMU_STEP_REWARD returns the sum of the per-frame rewards (same terms as
+// the Python calculate_reward, baseline reset by emu_reset), else 0.
+float emu_step_n(EmuHandle handle, u8 buttons, u32 n, u32 flags);
+
+// Get current screen buffer (240x160 RGB888)
+void emu_get_screen(EmuHandle handle, u8 *buffer);
+
+// Zero-copy views
+//
+// The pointers below stay valid until emu_cleanup() (emu_reset clears the
+// memory in place) and always show the current state, so Python can wrap
+// them once with np.frombuffer instead of copying every step. Treat them
+// as read-only: writes bypass the code cache and I/O side effects, use
+// emu_write_memory for those. Under EMU_RENDER_LAZY, call
+// emu_get_screen_ptr again before reading the screen so it gets drawn.
+
+// Screen formats (emu_set_screen_format)
+#define EMU_SCREEN_RGB888  0  // 240x160x3, the default
+#define EMU_SCREEN_RGB565  1  // 240x160 u16, the renderer's own framebuffer
+#define EMU_SCREEN_GRAY8   2  // 240x160 luminance
+
+#define EMU_SCREEN_BYTES (GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT * 3)  // One RGB888 observation
+
+// Select the format emu_get_screen_ptr exposes (converted once per emu_step)
+void emu_set_screen_format(EmuHandle handle, u32 format);
+
+// Current screen in the selected format and its size in bytes. Fetch the
+// pointer again after changing the format.
+const u8 *emu_get_screen_ptr(EmuHandle handle);
+u32 emu_get_screen_size(EmuHandle handle);
+
+// Render policies (emu_set_render_policy)
+//
+// Drawing the frame is a large share of emu_step, and an agent that only
+// reads RAM never looks at it. Whatever the policy, the frame is drawn from
+// the guest state at the end of emu_step (VBlank), so a lazily drawn screen
+// is identical to an eagerly drawn one.
+#define EMU_RENDER_ALWAYS   0  // Every emu_step, the default
+#define EMU_RENDER_NEVER    1  // Keep the last drawn screen
+#define EMU_RENDER_EVERY_N  2  // Steps where the frame count is a multiple of interval
+#define EMU_RENDER_LAZY     3  // On demand: emu_get_screen / emu_get_screen_ptr draw
+                               // the last frame if it hasn't been drawn yet
+
+// Select how emu_step renders (interval is used by EMU_RENDER_EVERY_N)
+void emu_set_render_policy(EmuHandle handle, u32 policy, u32 interval);
+
+// Memory regions (emu_get_memory_ptr)
+#define EMU_MEM_EWRAM    0  // 0x02000000, 256KB
+#define EMU_MEM_IWRAM    1  // 0x03000000, 32KB
+#define EMU_MEM_VRAM     2  // 0x06000000, 96KB
+#define EMU_MEM_OAM      3  // 0x07000000, 1KB
+#define EMU_MEM_PALETTE  4  // 0x05000000, 1KB
+#define EMU_MEM_SRAM     5  // 0x0E000000, 128KB flash save
+
+// Host address of a memory region; its size in bytes goes to *size
+// (NULL and 0 for an unknown region)
+u8 *emu_get_memory_ptr(EmuHandle handle, u32 region, u32 *size);
+
+// Dirty pages
+//
+// Every store to a memory region marks its 256-byte page (EMU_PAGE_SIZE),
+// whether it comes from the CPU, DMA or the Python side. Pages stay dirty
+// until emu_clear_dirty(); reset and loading a state mark everything.
+#define EMU_PAGE_SIZE 256
+
+// Write the indices of the region's dirty pages (byte offset / EMU_PAGE_SIZE)
+// to pages, at most max of them. Returns the number of dirty pages, which
+// may exceed max.
+u32 emu_get_dirty_pages(EmuHandle handle, u32 region, u32 *pages, u32 max);
+
+// Start a new tracking interval
+void emu_clear_dirty(EmuHandle handle);
+
+// Reset emulator to initial state
+void emu_reset(EmuHandle handle);
+
+// Cleanup and free emulator
+void emu_cleanup(EmuHandle handle);
+
+// Memory access
+u8 emu_read_memory(EmuHandle handle, u32 addr);
+void emu_write_memory(EmuHandle handle, u32 addr, u8 value);
+
+// Get emulator statistics
+u32 emu_get_frame_count(EmuHandle handle);
+u32 emu_get_cpu_cycles(EmuHandle handle);
+
+// Save state management (false on I/O error or an incompatible file)
+bool emu_save_state(EmuHandle handle, const char *filename);
+bool emu_load_state(EmuHandle handle, const char *filename);
+
+// In-memory snapshots: CPU, RAM, I/O, flash, GPIO, RTC, timers, DMA,
+// scheduler and the current screen. No file I/O; a snapshot/restore pair is a
+// few hundred KB of memcpy. buffer must hold emu_snapshot_size() bytes.
+u32 emu_snapshot_size(void);
+bool emu_snapshot(EmuHandle handle, u8 *buffer);
+bool emu_restore(EmuHandle handle, const u8 *buffer);
+
+// Forks
+//
+// emu_fork() returns an independent instance in the exact state of its
+// parent, sharing the parent's ROM. emu_cleanup() on a fork hands it back to
+// the parent instead of freeing it; the next fork reuses it and copies only
+// the memory pages that either side wrote since they last matched (plus the
+// CPU/device registers and framebuffer), so branching many times from one
+// state costs a few KB per branch instead of a full snapshot. Cleaning up
+// the parent frees all its forks. Forks of one parent must be created and
+// released on one thread at a time.
+EmuHandle emu_fork(EmuHandle parent);
+
+// Rewind
+//
+// With rewind enabled every emu_step() records the new state in a bounded
+// history: a keyframe every keyframe_interval frames and XOR/RLE deltas in
+// between, so a frame costs roughly the bytes it changed. The oldest frames
+// are dropped once max_bytes is used. The history does not survive a jump:
+// emu_reset, emu_load_state, emu_restore and emu_store_restore start it over
+// at the new state.
+
+// Start recording (the current state is the first entry); max_bytes = 0
+// turns rewind off and frees the history. False if out of memory.
+bool emu_rewind_enable(EmuHandle handle, u32 keyframe_interval, u32 max_bytes);
+
+// Go back up to 'frames' steps; returns how many were undone. Stepping on
+// afterwards records a new future from there.
+u32 emu_rewind(EmuHandle handle, u32 frames);
+
+// Steps emu_rewind can undo right now
+u32 emu_rewind_depth(EmuHandle handle);
+
+// Snapshot store
+//
+// Archive for many states of one ROM. States are split into
+// EMU_STORE_PAGE_SIZE pages and each distinct page is kept once with a
+// reference count, so states that differ in a few pages cost little more
+// than their page table. With max_bytes set, the least recently used states
+// (put or restored) are evicted to stay under it; 0 means no limit. Ids are
+// never reused, and restoring an evicted id returns false. A store is not
+// thread-safe.
+typedef void* EmuStoreHandle;
+
+#define EMU_STORE_PAGE_SIZE 1024
+
+EmuStoreHandle emu_store_create(u64 max_bytes);
+void emu_store_destroy(EmuStoreHandle store);
+
+// Add the current state of an emulator; returns its id (0 on failure)
+u64 emu_store_put(EmuStoreHandle store, EmuHandle handle);
+
+// Load a stored state into any emulator running the same ROM
+bool emu_store_restore(EmuStoreHandle store, EmuHandle handle, u64 id);
+
+// Remove a state now (false if it was already evicted)
+bool emu_store_evict(EmuStoreHandle store, u64 id);
+
+// Live states and host bytes held (unique pages + page tables)
+u32 emu_store_count(EmuStoreHandle store);
+u64 emu_store_bytes(EmuStoreHandle store);
+
+// Batched environments
+//
+// N emulators sharing one ROM image, stepped in parallel on an internal
+// work-stealing thread pool. Each call returns once all N are done, so a
+// vectorized environment needs one foreign call per step instead of N.
+typedef void* EmuBatchHandle;
+
+// Create 'count' emulators for one ROM (one thread per CPU)
+EmuBatchHandle emu_batch_create(u32 count, const char *rom_path);
+
+// Same with EMU_INIT_* flags and an explicit thread count (0 = one per CPU)
+EmuBatchHandle emu_batch_create_ex(u32 count, const char *rom_path, u32 flags, u32 threads);
+
+// Run one frame on the first 'count' instances, actions[i] = buttons of instance i
+void emu_batch_step(EmuBatchHandle batch, const u8 *actions, u32 count);
+
+// emu_step_n on the first 'count' instances; rewards[i] gets instance i's
+// reward (rewards may be NULL without EMU_STEP_REWARD)
+void emu_batch_step_n(EmuBatchHandle batch, const u8 *actions, u32 count, u32 n, u32 flags,
+                      float *rewards);
+
+// Screen format of every instance (EMU_SCREEN_*)
+void emu_batch_set_screen_format(EmuBatchHandle batch, u32 format);
+
+// Render policy of every instance (EMU_RENDER_*)
+void emu_batch_set_render_policy(EmuBatchHandle batch, u32 policy, u32 interval);
+
+// Copy every instance's screen to out, instance-major. Each takes
+// emu_get_screen_size() bytes (EMU_SCREEN_BYTES for the default RGB888).
+void emu_batch_get_obs(EmuBatchHandle batch, u8 *out);
+
+// Individual instance (for emu_read_memory, emu_reset, ...); owned by the batch
+EmuHandle emu_batch_get(EmuBatchHandle batch, u32 index);
+u32 emu_batch_size(EmuBatchHandle batch);
+
+void emu_batch_destroy(EmuBatchHandle batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PYTHON_API_H
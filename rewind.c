@@ -0,0 +1,237 @@
+#include "rewind.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Encoded frame: records of [u32 words to skip][u32 literal words][literal
+// words], each literal word being new ^ old. Trailing equal words are not
+// stored. A keyframe is encoded against an all-zero state.
+
+typedef struct RewindEntry {
+    u32 offset;           // Position in the ring
+    u32 size;             // Encoded bytes
+    bool key;             // Keyframe (decodes on its own)
+} RewindEntry;
+
+struct RewindBuffer {
+    u32 words;            // State size in 64-bit words
+    u32 interval;         // Frames per keyframe
+    u32 since_key;        // Deltas recorded after the newest keyframe
+    
+    u8 *ring;
+    u32 ring_size;
+    u32 head;             // Where the next record goes
+    
+    RewindEntry *entries; // Oldest first, circular
+    u32 entry_capacity;
+    u32 first;
+    u32 count;
+    
+    u64 *prev;            // Newest recorded state
+    u8 *scratch;          // Encoder output (worst case size)
+};
+
+static inline u64 word_at(const u64 *state, u32 i) {
+    return state ? state[i] : 0;
+}
+
+// Encode cur against old (NULL = zeros); returns the encoded size
+static u32 delta_encode(const u64 *cur, const u64 *old, u32 words, u8 *out) {
+    u8 *p = out;
+    u32 i = 0;
+    
+    while (i < words) {
+        u32 start = i;
+        while (i < words && cur[i] == word_at(old, i)) i++;
+        if (i == words) break;
+        u32 skip = i - start;
+        
+        // A record header costs two words, so only two equal words in a row
+        // end a literal run
+        u32 literal = i;
+        while (i < words) {
+            if (cur[i] == word_at(old, i) &&
+                (i + 1 == words || cur[i + 1] == word_at(old, i + 1))) break;
+            i++;
+        }
+        u32 count = i - literal;
+        
+        memcpy(p, &skip, sizeof(u32));
+        memcpy(p + 4, &count, sizeof(u32));
+        p += 8;
+        for (u32 j = literal; j < i; j++) {
+            u64 diff = cur[j] ^ word_at(old, j);
+            memcpy(p, &diff, sizeof(u64));
+            p += 8;
+        }
+    }
+    return (u32)(p - out);
+}
+
+// XOR an encoded frame into state
+static void delta_apply(u64 *state, const u8 *data, u32 size) {
+    const u8 *end = data + size;
+    u32 i = 0;
+    
+    while (data < end) {
+        u32 skip, count;
+        memcpy(&skip, data, sizeof(u32));
+        memcpy(&count, data + 4, sizeof(u32));
+        data += 8;
+        i += skip;
+        for (u32 j = 0; j < count; j++) {
+            u64 diff;
+            memcpy(&diff, data, sizeof(u64));
+            state[i++] ^= diff;
+            data += 8;
+        }
+    }
+}
+
+static RewindEntry *entry_at(RewindBuffer *rewind, u32 index) {
+    return &rewind->entries[(rewind->first + index) % rewind->entry_capacity];
+}
+
+// Drop the oldest keyframe and the deltas that depend on it
+static void drop_oldest_group(RewindBuffer *rewind) {
+    do {
+        rewind->first = (rewind->first + 1) % rewind->entry_capacity;
+        rewind->count--;
+    } while (rewind->count && !entry_at(rewind, 0)->key);
+}
+
+// Ring bytes a record takes. An empty one (an unchanged frame, or the
+// keyframe of an all-zero state) still holds one, or records written over
+// it would never evict it.
+static inline u32 span(u32 size) {
+    return size ? size : 1;
+}
+
+static bool overlaps(const RewindEntry *entry, u32 start, u32 end) {
+    return entry->offset < end && start < entry->offset + span(entry->size);
+}
+
+// Copy an encoded frame from scratch into the ring, evicting old groups
+static bool store(RewindBuffer *rewind, u32 size, bool key) {
+    if (span(size) > rewind->ring_size) {
+        rewind_clear(rewind);
+        return false;
+    }
+    if (rewind->count == 0) rewind->head = 0;
+    
+    // Records are contiguous; wrapping also gives up the end of the ring
+    u32 pos = rewind->head;
+    bool wrap = pos + span(size) > rewind->ring_size;
+    if (wrap) pos = 0;
+    while (rewind->count) {
+        const RewindEntry *oldest = entry_at(rewind, 0);
+        if (!overlaps(oldest, pos, pos + span(size)) &&
+            !(wrap && overlaps(oldest, rewind->head, rewind->ring_size))) break;
+        drop_oldest_group(rewind);
+    }
+    
+    // A delta needs its keyframe
+    if (!key && rewind->count == 0) return false;
+    
+    if (rewind->count == rewind->entry_capacity) {
+        u32 capacity = rewind->entry_capacity ? rewind->entry_capacity * 2 : 256;
+        RewindEntry *entries = (RewindEntry*)malloc(capacity * sizeof(RewindEntry));
+        if (!entries) return false;
+        for (u32 i = 0; i < rewind->count; i++) {
+            entries[i] = *entry_at(rewind, i);
+        }
+        free(rewind->entries);
+        rewind->entries = entries;
+        rewind->entry_capacity = capacity;
+        rewind->first = 0;
+    }
+    
+    memcpy(rewind->ring + pos, rewind->scratch, size);
+    RewindEntry *entry = entry_at(rewind, rewind->count++);
+    entry->offset = pos;
+    entry->size = size;
+    entry->key = key;
+    rewind->head = pos + span(size);
+    return true;
+}
+
+RewindBuffer *rewind_create(u32 state_size, u32 interval, u32 max_bytes) {
+    if (state_size == 0 || (state_size & 7) || interval == 0 || max_bytes == 0) return NULL;
+    
+    RewindBuffer *rewind = (RewindBuffer*)calloc(1, sizeof(RewindBuffer));
+    if (!rewind) return NULL;
+    
+    rewind->words = state_size / 8;
+    rewind->interval = interval;
+    rewind->ring_size = max_bytes;
+    rewind->ring = (u8*)malloc(max_bytes);
+    rewind->prev = (u64*)malloc(state_size);
+    // Worst case: one header per literal word plus the skipped word after it
+    rewind->scratch = (u8*)malloc((size_t)state_size * 2 + 16);
+    if (!rewind->ring || !rewind->prev || !rewind->scratch) {
+        rewind_destroy(rewind);
+        return NULL;
+    }
+    return rewind;
+}
+
+void rewind_destroy(RewindBuffer *rewind) {
+    if (!rewind) return;
+    
+    free(rewind->ring);
+    free(rewind->entries);
+    free(rewind->prev);
+    free(rewind->scratch);
+    free(rewind);
+}
+
+void rewind_clear(RewindBuffer *rewind) {
+    rewind->count = 0;
+    rewind->first = 0;
+    rewind->head = 0;
+    rewind->since_key = 0;
+}
+
+void rewind_push(RewindBuffer *rewind, const u8 *state) {
+    if (!rewind || !state) return;
+    
+    const u64 *cur = (const u64*)state;
+    bool key = rewind->count == 0 || rewind->since_key + 1 >= rewind->interval;
+    u32 size = delta_encode(cur, key ? NULL : rewind->prev, rewind->words, rewind->scratch);
+    if (!store(rewind, size, key)) {
+        // Evicting made room by dropping this delta's keyframe
+        if (key || rewind->count) return;
+        key = true;
+        size = delta_encode(cur, NULL, rewind->words, rewind->scratch);
+        if (!store(rewind, size, key)) return;
+    }
+    
+    memcpy(rewind->prev, state, (size_t)rewind->words * 8);
+    rewind->since_key = key ? 0 : rewind->since_key + 1;
+}
+
+u32 rewind_depth(const RewindBuffer *rewind) {
+    return rewind && rewind->count ? rewind->count - 1 : 0;
+}
+
+bool rewind_seek(RewindBuffer *rewind, u32 frames, u8 *out) {
+    if (!rewind || !out || rewind->count == 0 || frames >= rewind->count) return false;
+    
+    u32 target = rewind->count - 1 - frames;
+    u32 key = target;
+    while (!entry_at(rewind, key)->key) key--;
+    
+    // Keyframe, then the deltas up to the target
+    u64 *state = rewind->prev;
+    memset(state, 0, (size_t)rewind->words * 8);
+    for (u32 i = key; i <= target; i++) {
+        const RewindEntry *entry = entry_at(rewind, i);
+        delta_apply(state, rewind->ring + entry->offset, entry->size);
+    }
+    memcpy(out, state, (size_t)rewind->words * 8);
+    
+    const RewindEntry *newest = entry_at(rewind, target);
+    rewind->count = target + 1;
+    rewind->head = newest->offset + span(newest->size);
+    rewind->since_key = target - key;
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "types.h"
+
+// Rewind history for fixed-size states
+//
+// rewind_push() records one state per frame in a bounded byte ring: a
+// keyframe every 'interval' frames and the XOR with the previous state in
+// between. Both are run-length encoded (runs of equal 64-bit words are
+// skipped), so a frame that touched a few KB costs about that much. When
+// the ring is full the oldest keyframe and its deltas are dropped together;
+// the history always starts at a keyframe.
+
+typedef struct RewindBuffer RewindBuffer;
+
+// History for states of state_size bytes (a multiple of 8) in max_bytes of
+// ring. Returns NULL on failure.
+RewindBuffer *rewind_create(u32 state_size, u32 interval, u32 max_bytes);
+void rewind_destroy(RewindBuffer *rewind);
+
+// Forget every recorded state
+void rewind_clear(RewindBuffer *rewind);
+
+// Record the state after a frame. A state that doesn't fit in the ring
+// leaves the history empty.
+void rewind_push(RewindBuffer *rewind, const u8 *state);
+
+// States recorded before the newest one (how far rewind_seek can go)
+u32 rewind_depth(const RewindBuffer *rewind);
+
+// Rebuild the state 'frames' steps before the newest into out and drop the
+// newer ones, so recording continues from there. frames must be at most
+// rewind_depth(); false otherwise.
+bool rewind_seek(RewindBuffer *rewind, u32 frames, u8 *out);
+
+#endif // REWIND_H
@@ -1,4 +1,9 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE  // localtime_r
+#endif
+
 #include "rtc.h"
+#include "memory.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -22,11 +27,17 @@ void rtc_init(RTCState *rtc) {
     // Initialize with current system time
     rtc->base_timestamp = time(NULL);
     
-    // Set initial time values
-    struct tm *current_time = localtime(&rtc->base_timestamp);
-    rtc->seconds = current_time->tm_sec;
-    rtc->minutes = current_time->tm_min;
-    rtc->hours = current_time->tm_hour;
+    // Set initial time values (reentrant localtime: emulators may start
+    // on several threads at once)
+    struct tm current_time;
+#ifdef _WIN32
+    localtime_s(&current_time, &rtc->base_timestamp);
+#else
+    localtime_r(&rtc->base_timestamp, &current_time);
+#endif
+    rtc->seconds = current_time.tm_sec;
+    rtc->minutes = current_time.tm_min;
+    rtc->hours = current_time.tm_hour;
     
     // Calculate days since epoch (simplified)
     rtc->days_low = 0;
@@ -42,9 +53,9 @@ void rtc_init(RTCState *rtc) {
 void rtc_update(RTCState *rtc) {
     if (!rtc) return;
     
-    // Calculate elapsed time since base
-    time_t now = time(NULL);
-    time_t elapsed = now - rtc->base_timestamp;
+    // Elapsed time follows emulated time, so runs faster or slower than
+    // real time see the same clock
+    time_t elapsed = rtc->elapsed_seconds;
     
     // Update time values
     rtc->seconds = (u8)(elapsed % 60);
@@ -57,6 +68,11 @@ void rtc_update(RTCState *rtc) {
     rtc->days_high = (days >> 8) & 0xFF;
 }
 
+void rtc_tick(RTCState *rtc) {
+    if (!rtc) return;
+    rtc->elapsed_seconds++;
+}
+
 u8 rtc_gpio_read(RTCState *rtc, u16 gpio_data, u16 gpio_direction) {
     if (!rtc) return 0;
     
@@ -77,7 +93,7 @@ u8 rtc_gpio_read(RTCState *rtc, u16 gpio_data, u16 gpio_direction) {
     return 0;
 }
 
-void rtc_gpio_write(RTCState *rtc, u16 gpio_data, u16 gpio_direction) {
+void rtc_gpio_write(RTCState *rtc, MemDebug *debug, u16 gpio_data, u16 gpio_direction) {
     if (!rtc) return;
     
     u8 sck = (gpio_data & RTC_SCK) ? 1 : 0;
@@ -92,10 +108,9 @@ void rtc_gpio_write(RTCState *rtc, u16 gpio_data, u16 gpio_direction) {
         rtc->writing = true;
         memset(rtc->data_buffer, 0, sizeof(rtc->data_buffer));
         
-        static int gpio_write_count = 0;
-        if (gpio_write_count < 5) {
+        if (debug->rtc_cs_rise_logs < 5) {
             printf("[RTC] CS rising edge - start communication\n");
-            gpio_write_count++;
+            debug->rtc_cs_rise_logs++;
         }
     }
     
@@ -104,10 +119,9 @@ void rtc_gpio_write(RTCState *rtc, u16 gpio_data, u16 gpio_direction) {
         rtc->reading = false;
         rtc->writing = false;
         
-        static int gpio_end_count = 0;
-        if (gpio_end_count < 5) {
+        if (debug->rtc_cs_fall_logs < 5) {
             printf("[RTC] CS falling edge - end communication\n");
-            gpio_end_count++;
+            debug->rtc_cs_fall_logs++;
         }
     }
     
@@ -132,10 +146,9 @@ void rtc_gpio_write(RTCState *rtc, u16 gpio_data, u16 gpio_direction) {
             if (rtc->bit_index == 8) {
                 rtc->command = rtc->data_buffer[0];
                 
-                static int cmd_count = 0;
-                if (cmd_count < 5) {
+                if (debug->rtc_command_logs < 5) {
                     printf("[RTC] Received command: 0x%02X\n", rtc->command);
-                    cmd_count++;
+                    debug->rtc_command_logs++;
                 }
                 
                 // Prepare response based on command
@@ -156,11 +169,10 @@ void rtc_gpio_write(RTCState *rtc, u16 gpio_data, u16 gpio_direction) {
                     rtc->data_buffer[6] = rtc->control;
                     rtc->data_buffer[7] = rtc->status;
                     
-                    static int time_read_count = 0;
-                    if (time_read_count < 3) {
+                    if (debug->rtc_time_logs < 3) {
                         printf("[RTC] Sending time: %02d:%02d:%02d\n",
                                rtc->hours, rtc->minutes, rtc->seconds);
-                        time_read_count++;
+                        debug->rtc_time_logs++;
                     }
                 }
                 else if ((rtc->command & 0x0F) == 0x02) {  // Read status
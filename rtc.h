@@ -4,6 +4,9 @@
 #include "types.h"
 #include <time.h>
 
+// Forward declaration (MemDebug is defined in memory.h)
+typedef struct MemDebug MemDebug;
+
 // RTC (Real-Time Clock) state for Pokemon games
 // The RTC is accessed through GPIO pins on the cartridge
 
@@ -33,11 +36,14 @@ typedef struct RTCState {
     
     // Base time for calculating elapsed time
     time_t base_timestamp;
+    u32 elapsed_seconds;  // Emulated seconds since power-on (see rtc_tick)
 } RTCState;
 
 void rtc_init(RTCState *rtc);
 void rtc_update(RTCState *rtc);
+void rtc_tick(RTCState *rtc);  // Called once per emulated second by the scheduler
 u8 rtc_gpio_read(RTCState *rtc, u16 gpio_data, u16 gpio_direction);
-void rtc_gpio_write(RTCState *rtc, u16 gpio_data, u16 gpio_direction);
+// 'debug' holds the protocol log rate limits (host side, see MemDebug)
+void rtc_gpio_write(RTCState *rtc, MemDebug *debug, u16 gpio_data, u16 gpio_direction);
 
 #endif // RTC_H
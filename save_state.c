@@ -1,172 +1,121 @@
-#include "save_state.h"
-#include "types.h"
-#include "cpu_core.h"
-#include "memory.h"
-#include "gfx_renderer.h"
-#include "input.h"
-#include "interrupts.h"
-#include "timer.h"
-#include "dma.h"
-#include <stdio.h>
-#include <string.h>
-#include <stdlib.h>
-
-#define SAVE_STATE_MAGIC 0x454D4552  // "EMER"
-#define SAVE_STATE_VERSION 1
-
-typedef struct {
-    u32 magic;
-    u32 version;
-    u64 frame_count;
-    ARM7TDMI cpu;
-    u8 ewram[EWRAM_SIZE];
-    u8 iwram[IWRAM_SIZE];
-    u8 io_regs[IO_SIZE];
-    u8 palette[PALETTE_SIZE];
-    u8 vram[VRAM_SIZE];
-    u8 oam[OAM_SIZE];
-    InterruptState interrupts;
-    TimerState timers;
-    DMAState dma;
-    // Note: ROM is not saved, it's loaded separately
-} SaveStateData;
-
-// Forward declare EmulatorState structure
-struct EmulatorState {
-    ARM7TDMI cpu;
-    Memory memory;
-    GFXState gfx;
-    InputState input;
-    InterruptState interrupts;
-    TimerState timers;
-    DMAState dma;
-    u8 *rom_data;
-    u32 rom_size;
-    u64 frame_count;
-};
-
-u32 get_save_state_size(void) {
-    return sizeof(SaveStateData);
-}
-
-bool save_state_to_buffer(struct EmulatorState *emu, u8 *buffer, u32 *size) {
-    if (!emu || !buffer || !size) return false;
-    
-    if (*size < sizeof(SaveStateData)) {
-        *size = sizeof(SaveStateData);
-        return false;
-    }
-    
-    SaveStateData *save = (SaveStateData*)buffer;
-    
-    save->magic = SAVE_STATE_MAGIC;
-    save->version = SAVE_STATE_VERSION;
-    save->frame_count = emu->frame_count;
-    save->cpu = emu->cpu;
-    
-    memcpy(save->ewram, emu->memory.ewram, EWRAM_SIZE);
-    memcpy(save->iwram, emu->memory.iwram, IWRAM_SIZE);
-    memcpy(save->io_regs, emu->memory.io_regs, IO_SIZE);
-    memcpy(save->palette, emu->memory.palette, PALETTE_SIZE);
-    memcpy(save->vram, emu->memory.vram, VRAM_SIZE);
-    memcpy(save->oam, emu->memory.oam, OAM_SIZE);
-    
-    save->interrupts = emu->interrupts;
-    save->timers = emu->timers;
-    save->dma = emu->dma;
-    
-    *size = sizeof(SaveStateData);
-    return true;
-}
-
-bool load_state_from_buffer(struct EmulatorState *emu, const u8 *buffer, u32 size) {
-    if (!emu || !buffer || size < sizeof(SaveStateData)) return false;
-    
-    const SaveStateData *save = (const SaveStateData*)buffer;
-    
-    if (save->magic != SAVE_STATE_MAGIC) {
-        fprintf(stderr, "Invalid save state magic\n");
-        return false;
-    }
-    
-    if (save->version != SAVE_STATE_VERSION) {
-        fprintf(stderr, "Incompatible save state version\n");
-        return false;
-    }
-    
-    emu->frame_count = save->frame_count;
-    emu->cpu = save->cpu;
-    
-    memcpy(emu->memory.ewram, save->ewram, EWRAM_SIZE);
-    memcpy(emu->memory.iwram, save->iwram, IWRAM_SIZE);
-    memcpy(emu->memory.io_regs, save->io_regs, IO_SIZE);
-    memcpy(emu->memory.palette, save->palette, PALETTE_SIZE);
-    memcpy(emu->memory.vram, save->vram, VRAM_SIZE);
-    memcpy(emu->memory.oam, save->oam, OAM_SIZE);
-    
-    emu->interrupts = save->interrupts;
-    emu->timers = save->timers;
-    emu->dma = save->dma;
-    
-    return true;
-}
-
-bool save_state_to_file(struct EmulatorState *emu, const char *filename) {
-    if (!emu || !filename) return false;
-    
-    u32 size = sizeof(SaveStateData);
-    u8 *buffer = (u8*)malloc(size);
-    if (!buffer) return false;
-    
-    if (!save_state_to_buffer(emu, buffer, &size)) {
-        free(buffer);
-        return false;
-    }
-    
-    FILE *f = fopen(filename, "wb");
-    if (!f) {
-        free(buffer);
-        return false;
-    }
-    
-    size_t written = fwrite(buffer, 1, size, f);
-    fclose(f);
-    free(buffer);
-    
-    return written == size;
-}
-
-bool load_state_from_file(struct EmulatorState *emu, const char *filename) {
-    if (!emu || !filename) return false;
-    
-    FILE *f = fopen(filename, "rb");
-    if (!f) return false;
-    
-    fseek(f, 0, SEEK_END);
-    long file_size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    
-    if (file_size < (long)sizeof(SaveStateData)) {
-        fclose(f);
-        return false;
-    }
-    
-    u8 *buffer = (u8*)malloc(file_size);
-    if (!buffer) {
-        fclose(f);
-        return false;
-    }
-    
-    size_t read = fread(buffer, 1, file_size, f);
-    fclose(f);
-    
-    if (read != (size_t)file_size) {
-        free(buffer);
-        return false;
-    }
-    
-    bool result = load_state_from_buffer(emu, buffer, file_size);
-    free(buffer);
-    
-    return result;
-}
+#include "save_state.h"
+#include "types.h"
+#include "emulator.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define SAVE_STATE_MAGIC 0x454D4552  // "EMER"
+#define SAVE_STATE_VERSION 3
+
+// A save state is this header followed by the guest arena bytes
+// (GUEST_STATE_BYTES, see guest_state.h). The ROM is not saved, it's
+// loaded separately.
+typedef struct {
+    u32 magic;
+    u32 version;
+    u32 size;             // GUEST_STATE_BYTES of the build that wrote it
+    u32 reserved;         // Keeps the arena bytes 16-byte aligned
+} SaveStateHeader;
+
+u32 get_save_state_size(void) {
+    return (u32)(sizeof(SaveStateHeader) + GUEST_STATE_BYTES);
+}
+
+bool save_state_to_buffer(struct EmulatorState *emu, u8 *buffer, u32 *size) {
+    if (!emu || !buffer || !size) return false;
+    
+    if (*size < get_save_state_size()) {
+        *size = get_save_state_size();
+        return false;
+    }
+    
+    SaveStateHeader *header = (SaveStateHeader*)buffer;
+    header->magic = SAVE_STATE_MAGIC;
+    header->version = SAVE_STATE_VERSION;
+    header->size = (u32)GUEST_STATE_BYTES;
+    header->reserved = 0;
+    guest_save(emu->guest, buffer + sizeof(SaveStateHeader));
+    
+    *size = get_save_state_size();
+    return true;
+}
+
+bool load_state_from_buffer(struct EmulatorState *emu, const u8 *buffer, u32 size) {
+    if (!emu || !buffer || size < get_save_state_size()) return false;
+    
+    const SaveStateHeader *header = (const SaveStateHeader*)buffer;
+    
+    if (header->magic != SAVE_STATE_MAGIC) {
+        fprintf(stderr, "Invalid save state magic\n");
+        return false;
+    }
+    
+    if (header->version != SAVE_STATE_VERSION || header->size != GUEST_STATE_BYTES) {
+        fprintf(stderr, "Incompatible save state version\n");
+        return false;
+    }
+    
+    guest_load(emu->guest, buffer + sizeof(SaveStateHeader));
+    return true;
+}
+
+bool save_state_to_file(struct EmulatorState *emu, const char *filename) {
+    if (!emu || !filename) return false;
+    
+    u32 size = get_save_state_size();
+    u8 *buffer = (u8*)malloc(size);
+    if (!buffer) return false;
+    
+    if (!save_state_to_buffer(emu, buffer, &size)) {
+        free(buffer);
+        return false;
+    }
+    
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        free(buffer);
+        return false;
+    }
+    
+    size_t written = fwrite(buffer, 1, size, f);
+    fclose(f);
+    free(buffer);
+    
+    return written == size;
+}
+
+bool load_state_from_file(struct EmulatorState *emu, const char *filename) {
+    if (!emu || !filename) return false;
+    
+    FILE *f = fopen(filename, "rb");
+    if (!f) return false;
+    
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    
+    if (file_size < (long)get_save_state_size()) {
+        fclose(f);
+        return false;
+    }
+    
+    u8 *buffer = (u8*)malloc(file_size);
+    if (!buffer) {
+        fclose(f);
+        return false;
+    }
+    
+    size_t read = fread(buffer, 1, file_size, f);
+    fclose(f);
+    
+    if (read != (size_t)file_size) {
+        free(buffer);
+        return false;
+    }
+    
+    bool result = load_state_from_buffer(emu, buffer, file_size);
+    free(buffer);
+    
+    return result;
+}
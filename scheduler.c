@@ -0,0 +1,158 @@
+#include "scheduler.h"
+#include "memory.h"
+#include "interrupts.h"
+#include "timer.h"
+#include "dma.h"
+#include "rtc.h"
+#include <string.h>
+
+void scheduler_init(Scheduler *sched) {
+    memset(sched, 0, sizeof(Scheduler));
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        sched->slot[i] = -1;
+    }
+    
+    // Display starts at the top of scanline 0
+    scheduler_schedule(sched, EVENT_HBLANK, CYCLES_PER_HDRAW);
+    scheduler_schedule(sched, EVENT_SCANLINE, CYCLES_PER_SCANLINE);
+    scheduler_schedule(sched, EVENT_RTC, CYCLES_PER_SECOND);
+}
+
+static void heap_swap(Scheduler *sched, u32 a, u32 b) {
+    Event tmp = sched->heap[a];
+    sched->heap[a] = sched->heap[b];
+    sched->heap[b] = tmp;
+    sched->slot[sched->heap[a].type] = (s32)a;
+    sched->slot[sched->heap[b].type] = (s32)b;
+}
+
+static void heap_sift_up(Scheduler *sched, u32 i) {
+    while (i > 0) {
+        u32 parent = (i - 1) / 2;
+        if (sched->heap[parent].when <= sched->heap[i].when) break;
+        heap_swap(sched, i, parent);
+        i = parent;
+    }
+}
+
+static void heap_sift_down(Scheduler *sched, u32 i) {
+    for (;;) {
+        u32 smallest = i;
+        u32 left = 2 * i + 1;
+        u32 right = left + 1;
+        if (left < sched->count && sched->heap[left].when < sched->heap[smallest].when) smallest = left;
+        if (right < sched->count && sched->heap[right].when < sched->heap[smallest].when) smallest = right;
+        if (smallest == i) break;
+        heap_swap(sched, i, smallest);
+        i = smallest;
+    }
+}
+
+static void heap_remove(Scheduler *sched, u32 i) {
+    sched->slot[sched->heap[i].type] = -1;
+    sched->count--;
+    if (i == sched->count) return;
+    
+    sched->heap[i] = sched->heap[sched->count];
+    sched->slot[sched->heap[i].type] = (s32)i;
+    heap_sift_down(sched, i);
+    heap_sift_up(sched, i);
+}
+
+void scheduler_schedule(Scheduler *sched, EventType type, u64 when) {
+    if (when == UINT64_MAX) {
+        scheduler_cancel(sched, type);
+        return;
+    }
+    
+    s32 i = sched->slot[type];
+    if (i < 0) {
+        i = (s32)sched->count++;
+        sched->heap[i].type = type;
+        sched->slot[type] = i;
+    }
+    sched->heap[i].when = when;
+    heap_sift_down(sched, (u32)i);
+    heap_sift_up(sched, (u32)i);
+}
+
+void scheduler_cancel(Scheduler *sched, EventType type) {
+    if (sched->slot[type] >= 0) {
+        heap_remove(sched, (u32)sched->slot[type]);
+    }
+}
+
+void scheduler_sync_timers(Scheduler *sched, Memory *mem) {
+    if (mem->timers) {
+        timer_sync(mem->timers, sched->now, mem->interrupts);
+    }
+}
+
+void scheduler_reschedule_timers(Scheduler *sched, Memory *mem) {
+    for (int i = 0; i < 4; i++) {
+        u64 when = mem->timers ? timer_next_irq(mem->timers, i) : UINT64_MAX;
+        scheduler_schedule(sched, (EventType)(EVENT_TIMER0 + i), when);
+    }
+}
+
+static void handle_hblank(Scheduler *sched, Memory *mem) {
+    if (mem->interrupts) {
+        mem->interrupts->dispstat |= 0x02; // HBlank flag
+        if (mem->interrupts->dispstat & 0x10) { // HBlank IRQ enable
+            interrupt_raise(mem->interrupts, INT_HBLANK);
+        }
+    }
+    
+    // HBlank DMA only runs on visible scanlines
+    if (mem->dma && sched->scanline < GBA_SCREEN_HEIGHT) {
+        dma_trigger(mem->dma, mem, 2);
+    }
+}
+
+static void handle_scanline(Scheduler *sched, Memory *mem) {
+    sched->scanline = (sched->scanline + 1) % SCANLINES_PER_FRAME;
+    
+    if (mem->interrupts) {
+        mem->interrupts->dispstat &= ~0x02;
+        interrupt_update_vcount(mem->interrupts, sched->scanline);
+    }
+    
+    if (mem->dma && sched->scanline == GBA_SCREEN_HEIGHT) {
+        dma_trigger(mem->dma, mem, 1); // VBlank DMA
+    }
+    
+    if (sched->scanline == 0) {
+        sched->frame_done = true;
+    }
+}
+
+void scheduler_dispatch(Scheduler *sched, Memory *mem) {
+    while (sched->count && sched->heap[0].when <= sched->now) {
+        Event event = sched->heap[0];
+        heap_remove(sched, 0);
+        
+        // Periodic events are re-armed from their own deadline, not from
+        // 'now', so overshooting a deadline doesn't drift the display timing
+        switch (event.type) {
+            case EVENT_HBLANK:
+                handle_hblank(sched, mem);
+                break;
+            case EVENT_SCANLINE:
+                handle_scanline(sched, mem);
+                scheduler_schedule(sched, EVENT_HBLANK, event.when + CYCLES_PER_HDRAW);
+                scheduler_schedule(sched, EVENT_SCANLINE, event.when + CYCLES_PER_SCANLINE);
+                break;
+            case EVENT_TIMER0:
+            case EVENT_TIMER1:
+            case EVENT_TIMER2:
+            case EVENT_TIMER3:
+                scheduler_sync_timers(sched, mem);
+                scheduler_reschedule_timers(sched, mem);
+                break;
+            case EVENT_RTC:
+                rtc_tick(mem->rtc);
+                scheduler_schedule(sched, EVENT_RTC, event.when + CYCLES_PER_SECOND);
+                break;
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "types.h"
+
+// Forward declaration (Memory is defined in memory.h)
+typedef struct Memory_s Memory;
+
+// Event scheduler
+//
+// Everything that happens at a known point in time (display timing, timer
+// overflows, RTC seconds) is kept in a min-heap of absolute cycle stamps.
+// The CPU runs uninterrupted up to the earliest deadline, then the due events
+// are dispatched and the next deadline is taken from the heap.
+
+#define CYCLES_PER_HDRAW     960                        // Visible part of a scanline
+#define CYCLES_PER_SCANLINE  1232                       // HDraw + HBlank
+#define SCANLINES_PER_FRAME  228                        // 160 visible + 68 VBlank
+#define CYCLES_PER_FRAME     (CYCLES_PER_SCANLINE * SCANLINES_PER_FRAME)
+#define CYCLES_PER_SECOND    (1u << 24)                 // 16.78 MHz
+
+typedef enum EventType {
+    EVENT_HBLANK,     // End of HDraw on the current scanline
+    EVENT_SCANLINE,   // Start of the next scanline (VCount, VBlank)
+    EVENT_TIMER0,     // Timer overflows (only while they can raise an IRQ)
+    EVENT_TIMER1,
+    EVENT_TIMER2,
+    EVENT_TIMER3,
+    EVENT_RTC,        // One emulated second
+    EVENT_COUNT
+} EventType;
+
+typedef struct Event {
+    u64 when;         // Absolute cycle stamp
+    u32 type;         // EventType
+} Event;
+
+typedef struct Scheduler {
+    u64 now;                      // Cycles since reset
+    Event heap[EVENT_COUNT];      // Min-heap on 'when', one entry per type at most
+    s32 slot[EVENT_COUNT];        // Heap index of each type, -1 = not scheduled
+    u32 count;
+    u16 scanline;                 // Current VCOUNT
+    bool frame_done;              // Set when the display wraps back to scanline 0
+} Scheduler;
+
+void scheduler_init(Scheduler *sched);
+
+// Queue an event (replaces the pending one of the same type) or drop it
+void scheduler_schedule(Scheduler *sched, EventType type, u64 when);
+void scheduler_cancel(Scheduler *sched, EventType type);
+
+// Earliest pending deadline
+static inline u64 scheduler_next(const Scheduler *sched) {
+    return sched->count ? sched->heap[0].when : UINT64_MAX;
+}
+
+// Handle every event that is due at 'now' (display, DMA, timers, RTC)
+void scheduler_dispatch(Scheduler *sched, Memory *mem);
+
+// Timer registers are evaluated lazily: bring the counters up to 'now'
+// before they are read or written, and recompute the overflow events after
+// the timer configuration changes
+void scheduler_sync_timers(Scheduler *sched, Memory *mem);
+void scheduler_reschedule_timers(Scheduler *sched, Memory *mem);
+
+#endif // SCHEDULER_H
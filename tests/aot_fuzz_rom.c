@@ -0,0 +1,45 @@
+// Writes the random ROM and symbol file test_aot translates
+//
+// The code comes from thumb_fuzz.h with a fixed seed, so every build
+// translates and checks the same ROM. Function entries are random
+// addresses: random code rarely starts with the PUSH aot_gen looks for
+// behind BL targets.
+//
+// Usage: aot_fuzz_rom <out.gba> <out_symbols.txt>
+
+#include "thumb_fuzz.h"
+#include <stdio.h>
+
+#define FUZZ_ENTRIES 3000
+#define FUZZ_SEED    0x414F543Du
+
+static u8 rom[FUZZ_ROM_SIZE];
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <out.gba> <out_symbols.txt>\n", argv[0]);
+        return 1;
+    }
+
+    u32 seed = FUZZ_SEED;
+    fuzz_fill_rom(rom, &seed);
+
+    FILE *f = fopen(argv[1], "wb");
+    if (!f || fwrite(rom, 1, sizeof(rom), f) != sizeof(rom)) {
+        fprintf(stderr, "aot_fuzz_rom: cannot write %s\n", argv[1]);
+        return 1;
+    }
+    fclose(f);
+
+    FILE *syms = fopen(argv[2], "w");
+    if (!syms) {
+        fprintf(stderr, "aot_fuzz_rom: cannot write %s\n", argv[2]);
+        return 1;
+    }
+    for (int i = 0; i < FUZZ_ENTRIES; i++) {
+        u32 addr = 0x08000000 + (fuzz_rand(&seed) % (FUZZ_ROM_SIZE / 2)) * 2;
+        fprintf(syms, "%08x T fuzz_%d\n", addr, i);
+    }
+    fclose(syms);
+    return 0;
+}
@@ -0,0 +1,150 @@
+// Differential test of ahead-of-time translated code against the interpreter
+//
+// The build writes a random ROM (aot_fuzz_rom) and runs aot_gen on it; this
+// test links the result. Each trial starts two arenas at a random translated
+// block with the same CPU state (see thumb_fuzz.h). Both run cpu_run_block,
+// one of them with the translated code attached, and after every block the
+// cycles, registers, flags (after cpu_sync_flags), mode and RAM must match.
+// Code entering a BL pair at its second half from a translated block must
+// find that suffix translated as well.
+//
+// Usage: test_aot <fuzz.gba> [trials] [seed]
+
+#include "guest_state.h"
+#include "block_cache.h"
+#include "aot.h"
+#include "thumb_fuzz.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STEPS_PER_TRIAL 60
+
+static u8 rom[FUZZ_ROM_SIZE];
+
+static u16 rom_op(u32 pc) {
+    u32 offset = pc - 0x08000000;
+    return (u16)(rom[offset] | (rom[offset + 1] << 8));
+}
+
+static bool in_fuzz_rom(const ARM7TDMI *cpu) {
+    u32 pc = cpu->r[15] - 4;
+    return pc >= 0x08000000 && pc < 0x08000000 + FUZZ_ROM_SIZE;
+}
+
+// Compared on copies, like test_jit: translated code must leave the same
+// pending flags behind, not just the same flags once synced
+static bool same_state(const ARM7TDMI *a, const ARM7TDMI *b, const Memory *ma, const Memory *mb) {
+    ARM7TDMI x = *a, y = *b;
+    cpu_sync_flags(&x);
+    cpu_sync_flags(&y);
+    return memcmp(x.r, y.r, sizeof(x.r)) == 0 &&
+           x.cpsr == y.cpsr && x.thumb_mode == y.thumb_mode &&
+           memcmp(ma->iwram, mb->iwram, IWRAM_SIZE) == 0 &&
+           memcmp(ma->ewram, mb->ewram, EWRAM_SIZE) == 0;
+}
+
+static void report(long trial, int step, u32 pc, const ARM7TDMI *a, const ARM7TDMI *b, u32 ca, u32 cb) {
+    ARM7TDMI x = *a, y = *b;
+    cpu_sync_flags(&x);
+    cpu_sync_flags(&y);
+    fprintf(stderr, "MISMATCH trial %ld step %d, block %08X: cycles %u/%u, cpsr %08X/%08X\n",
+            trial, step, pc, ca, cb, x.cpsr, y.cpsr);
+    for (int r = 0; r < 16; r++) {
+        if (a->r[r] != b->r[r]) {
+            fprintf(stderr, "  r%d: interpreter %08X, aot %08X\n", r, a->r[r], b->r[r]);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <fuzz.gba> [trials] [seed]\n", argv[0]);
+        return 1;
+    }
+    long trials = argc > 2 ? atol(argv[2]) : 2000;
+    u32 seed = argc > 3 ? (u32)strtoul(argv[3], NULL, 0) : 0x414F5431u;
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f || fread(rom, 1, sizeof(rom), f) != sizeof(rom)) {
+        fprintf(stderr, "test_aot: cannot read %s\n", argv[1]);
+        return 1;
+    }
+    fclose(f);
+
+    const AotProgram *prog = aot_program_for_rom(rom, sizeof(rom));
+    if (!prog || prog->count == 0) {
+        fprintf(stderr, "test_aot: no translated code for %s\n", argv[1]);
+        return 1;
+    }
+
+    // The table is tied to the ROM it was built from
+    rom[0x200] ^= 1;
+    bool other_rom_rejected = aot_program_for_rom(rom, sizeof(rom)) == NULL;
+    rom[0x200] ^= 1;
+    if (!other_rom_rejected) {
+        fprintf(stderr, "test_aot: translated code accepted for a different ROM\n");
+        return 1;
+    }
+
+    GuestState *interp = guest_create();
+    GuestState *native = guest_create();
+    BlockCache *interp_cache = block_cache_create();
+    BlockCache *native_cache = block_cache_create();
+    if (!interp || !native || !interp_cache || !native_cache) {
+        fprintf(stderr, "test_aot: out of memory\n");
+        return 1;
+    }
+    Memory *ma = &interp->memory;
+    Memory *mb = &native->memory;
+    mem_set_rom(ma, rom, sizeof(rom));
+    mem_set_rom(mb, rom, sizeof(rom));
+    mem_set_block_cache(ma, interp_cache);
+    mem_set_block_cache(mb, native_cache);
+    mem_set_aot(mb, prog);
+
+    long failures = 0, aot_blocks = 0, suffixes = 0, suffixes_translated = 0;
+    for (long trial = 0; trial < trials && failures < 10; trial++) {
+        memset(ma->iwram, 0, IWRAM_SIZE);
+        memset(ma->ewram, 0, EWRAM_SIZE);
+        memset(mb->iwram, 0, IWRAM_SIZE);
+        memset(mb->ewram, 0, EWRAM_SIZE);
+
+        u32 start = prog->blocks[fuzz_rand(&seed) % prog->count].pc;
+        fuzz_cpu_state(&interp->cpu, &seed, start);
+        native->cpu = interp->cpu;
+
+        bool last_translated = false;
+        for (int step = 0; step < STEPS_PER_TRIAL; step++) {
+            ARM7TDMI *a = &interp->cpu;
+            ARM7TDMI *b = &native->cpu;
+            if (!b->thumb_mode || b->halted || !in_fuzz_rom(b)) break;
+
+            u32 pc = b->r[15] - 4;
+            bool translated = aot_lookup(prog, pc) != NULL;
+            if (translated) aot_blocks++;
+            if (last_translated && (rom_op(pc) >> 11) == 0x1F) {
+                suffixes++;
+                if (translated) suffixes_translated++;
+            }
+            last_translated = translated;
+
+            u32 cb = cpu_run_block(b, mb);
+            u32 ca = cpu_run_block(a, ma);
+            if (ca != cb || !same_state(a, b, ma, mb)) {
+                report(trial, step, pc, a, b, ca, cb);
+                failures++;
+                break;
+            }
+        }
+    }
+
+    printf("test_aot: %ld trials, %ld translated blocks run, %ld/%ld BL suffix entries translated, %ld mismatches\n",
+           trials, aot_blocks, suffixes_translated, suffixes, failures);
+
+    block_cache_destroy(interp_cache);
+    block_cache_destroy(native_cache);
+    guest_destroy(interp);
+    guest_destroy(native);
+    return (failures == 0 && aot_blocks > 0 && suffixes_translated == suffixes) ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+// Differential test of the x86-64 recompiler against the interpreter
+//
+// Each trial fills the ROM with random Thumb code (see thumb_fuzz.h) and
+// starts two arenas from the same CPU state. One runs jit_run with a random
+// cycle budget (falling back to cpu_run_block where the recompiler declines,
+// like cpu_run does), with some steps left to the interpreter so translated
+// code is entered with lazy flags pending; the other runs cpu_run_block
+// until it has spent the same cycles. Registers, flags (after cpu_sync_flags), mode, cycle counts
+// and RAM must then match. Halfway through, an interrupt is raised so the
+// chaining exit on pending IRQs is covered too.
+//
+// Usage: test_jit [trials] [seed]   (exit 77 = skipped, no recompiler)
+
+#include "guest_state.h"
+#include "block_cache.h"
+#include "jit_x64.h"
+#include "thumb_fuzz.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STEPS_PER_TRIAL 50
+
+static u8 rom[FUZZ_ROM_SIZE];
+
+static bool in_fuzz_rom(const ARM7TDMI *cpu) {
+    u32 pc = cpu->r[15] - 4;
+    return pc >= 0x08000000 && pc < 0x08000000 + FUZZ_ROM_SIZE;
+}
+
+// Compared on copies: syncing the flags of the running CPUs would hide a
+// translator that reads cpsr while the interpreter's flags are still pending
+static bool same_state(const ARM7TDMI *a, const ARM7TDMI *b, const Memory *ma, const Memory *mb) {
+    ARM7TDMI x = *a, y = *b;
+    cpu_sync_flags(&x);
+    cpu_sync_flags(&y);
+    return memcmp(x.r, y.r, sizeof(x.r)) == 0 &&
+           x.cpsr == y.cpsr && x.thumb_mode == y.thumb_mode &&
+           memcmp(ma->iwram, mb->iwram, IWRAM_SIZE) == 0 &&
+           memcmp(ma->ewram, mb->ewram, EWRAM_SIZE) == 0;
+}
+
+static void report(long trial, int step, const ARM7TDMI *a, const ARM7TDMI *b, u32 ca, u32 cb) {
+    ARM7TDMI x = *a, y = *b;
+    cpu_sync_flags(&x);
+    cpu_sync_flags(&y);
+    fprintf(stderr, "MISMATCH trial %ld step %d: cycles %u/%u, cpsr %08X/%08X\n",
+            trial, step, ca, cb, x.cpsr, y.cpsr);
+    for (int r = 0; r < 16; r++) {
+        if (a->r[r] != b->r[r]) {
+            fprintf(stderr, "  r%d: interpreter %08X, jit %08X\n", r, a->r[r], b->r[r]);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    long trials = argc > 1 ? atol(argv[1]) : 1000;
+    u32 seed = argc > 2 ? (u32)strtoul(argv[2], NULL, 0) : 0x4A49543Du;
+
+    JitState *jit = jit_create();
+    if (!jit) {
+        printf("test_jit: no recompiler on this host, skipped\n");
+        return 77;
+    }
+
+    GuestState *interp = guest_create();
+    GuestState *native = guest_create();
+    BlockCache *interp_cache = block_cache_create();
+    BlockCache *native_cache = block_cache_create();
+    if (!interp || !native || !interp_cache || !native_cache) {
+        fprintf(stderr, "test_jit: out of memory\n");
+        return 1;
+    }
+    Memory *ma = &interp->memory;
+    Memory *mb = &native->memory;
+    mem_set_rom(ma, rom, sizeof(rom));
+    mem_set_rom(mb, rom, sizeof(rom));
+    mem_set_block_cache(ma, interp_cache);
+    mem_set_block_cache(mb, native_cache);
+
+    long failures = 0, jit_calls = 0;
+    for (long trial = 0; trial < trials && failures < 10; trial++) {
+        fuzz_fill_rom(rom, &seed);
+        block_cache_flush(interp_cache);
+        block_cache_flush(native_cache);
+        jit_flush(jit);
+        memset(ma->iwram, 0, IWRAM_SIZE);
+        memset(ma->ewram, 0, EWRAM_SIZE);
+        memset(mb->iwram, 0, IWRAM_SIZE);
+        memset(mb->ewram, 0, EWRAM_SIZE);
+
+        u32 start = 0x08008000 + (fuzz_rand(&seed) & 0x7FFE);
+        fuzz_cpu_state(&interp->cpu, &seed, start);
+        native->cpu = interp->cpu;
+        interp->interrupts.ime = native->interrupts.ime = (u16)(trial & 1);
+        interp->interrupts.ie = native->interrupts.ie = 1;
+        interp->interrupts.if_flag = native->interrupts.if_flag = 0;
+
+        for (int step = 0; step < STEPS_PER_TRIAL; step++) {
+            ARM7TDMI *a = &interp->cpu;
+            ARM7TDMI *b = &native->cpu;
+            if (!b->thumb_mode || b->halted || !in_fuzz_rom(b)) break;
+            if (step == STEPS_PER_TRIAL / 2) {
+                interp->interrupts.if_flag = native->interrupts.if_flag = 1;
+            }
+
+            u32 budget = 1 + fuzz_rand(&seed) % 400;
+            u32 cb = (fuzz_rand(&seed) % 4) ? jit_run(jit, b, mb, budget) : 0;
+            if (cb) {
+                jit_calls++;
+            } else {
+                cb = cpu_run_block(b, mb);
+            }
+            u32 ca = 0;
+            while (ca < cb) ca += cpu_run_block(a, ma);
+
+            if (ca != cb || !same_state(a, b, ma, mb)) {
+                report(trial, step, a, b, ca, cb);
+                failures++;
+                break;
+            }
+        }
+    }
+
+    printf("test_jit: %ld trials, %ld jit_run calls, %ld mismatches\n", trials, jit_calls, failures);
+
+    jit_destroy(jit);
+    block_cache_destroy(interp_cache);
+    block_cache_destroy(native_cache);
+    guest_destroy(interp);
+    guest_destroy(native);
+    return (failures == 0 && jit_calls > 0) ? 0 : 1;
+}
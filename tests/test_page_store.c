@@ -0,0 +1,208 @@
+// Round trips through the page store
+//
+// Puts states, reads them back and evicts them, checking the contents byte
+// for byte and the page accounting: identical states share every page, a
+// state differing in one byte adds one page, and pages go away with the
+// last state holding them. Then a random put/get/evict mix exercises page
+// reuse and the hash index, and a byte budget the LRU eviction.
+//
+// Usage: test_page_store [seed]
+
+#include "page_store.h"
+#include "thumb_fuzz.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STATE_SIZE 40000        // Not a multiple of the page size: a partial last page
+#define PAGE_SIZE  256
+#define PAGES      ((STATE_SIZE + PAGE_SIZE - 1) / PAGE_SIZE)
+#define POOL       64           // States in the random mix
+
+static int failures;
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        fprintf(stderr, "FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+static void random_state(u8 *state, u32 *seed) {
+    for (u32 i = 0; i < STATE_SIZE; i++) state[i] = (u8)fuzz_rand(seed);
+}
+
+static int compare_pages(const void *x, const void *y) {
+    return memcmp(*(const u8* const*)x, *(const u8* const*)y, PAGE_SIZE);
+}
+
+// Distinct pages among count states (the partial last pages zero-padded,
+// as the store keeps them)
+static u32 distinct_pages(const u8 *const *states, u32 count) {
+    u8 *copies = (u8*)calloc((size_t)count * PAGES, PAGE_SIZE);
+    const u8 **pages = (const u8**)malloc((size_t)count * PAGES * sizeof(u8*));
+    if (!copies || !pages) {
+        fprintf(stderr, "test_page_store: out of memory\n");
+        exit(1);
+    }
+    u32 n = 0;
+    for (u32 s = 0; s < count; s++) {
+        for (u32 p = 0; p < PAGES; p++, n++) {
+            u32 left = STATE_SIZE - p * PAGE_SIZE;
+            memcpy(copies + (size_t)n * PAGE_SIZE, states[s] + (size_t)p * PAGE_SIZE,
+                   left < PAGE_SIZE ? left : PAGE_SIZE);
+            pages[n] = copies + (size_t)n * PAGE_SIZE;
+        }
+    }
+    qsort(pages, n, sizeof(pages[0]), compare_pages);
+    u32 distinct = 0;
+    for (u32 i = 0; i < n; i++) {
+        if (i == 0 || memcmp(pages[i - 1], pages[i], PAGE_SIZE) != 0) distinct++;
+    }
+    free(copies);
+    free(pages);
+    return distinct;
+}
+
+static bool same_as(PageStore *store, u64 id, const u8 *state, u8 *out) {
+    return page_store_get(store, id, out) && memcmp(out, state, STATE_SIZE) == 0;
+}
+
+static void test_sharing(u8 *a, u8 *b, u8 *out) {
+    PageStore *store = page_store_create(STATE_SIZE, PAGE_SIZE, 0);
+
+    u64 first = page_store_put(store, a);
+    check(first != 0 && same_as(store, first, a, out), "put/get");
+    check(page_store_pages(store) == PAGES, "one page per page of state");
+
+    // Identical state: no new pages
+    u64 copy = page_store_put(store, a);
+    check(copy != 0 && copy != first, "second put gets its own id");
+    check(page_store_pages(store) == PAGES, "identical states share every page");
+    check(page_store_states(store) == 2, "two states");
+
+    // One byte different: one new page
+    memcpy(b, a, STATE_SIZE);
+    b[3 * PAGE_SIZE + 17] ^= 0x5A;
+    u64 changed = page_store_put(store, b);
+    check(page_store_pages(store) == PAGES + 1, "a one-byte change adds one page");
+    check(same_as(store, first, a, out) && same_as(store, copy, a, out) && same_as(store, changed, b, out),
+          "every state reads back");
+
+    // Pages stay while any state holds them
+    check(page_store_evict(store, first), "evict");
+    check(!page_store_get(store, first, out), "get after evict fails");
+    check(!page_store_evict(store, first), "second evict fails");
+    check(page_store_pages(store) == PAGES + 1, "shared pages survive an evict");
+    check(same_as(store, copy, a, out), "the copy still reads back");
+    check(page_store_evict(store, copy), "evict the copy");
+    check(page_store_pages(store) == PAGES, "a page goes with the last state holding it");
+    check(same_as(store, changed, b, out), "the changed state still reads back");
+    check(page_store_evict(store, changed), "evict the last state");
+    check(page_store_states(store) == 0 && page_store_pages(store) == 0 && page_store_bytes(store) == 0,
+          "an empty store holds nothing");
+
+    // Ids are never reused
+    u64 again = page_store_put(store, a);
+    check(again != first && again != copy && again != changed, "new id after evicts");
+    check(same_as(store, again, a, out), "put after emptying");
+    page_store_destroy(store);
+}
+
+// States derived from a few bases, so pages are shared in all sorts of
+// patterns; random puts, gets and evicts against a reference copy. In the
+// end the store must hold exactly the distinct pages of the live states.
+static void test_mix(u32 *seed, u8 *out) {
+    u8 *bases = (u8*)malloc((size_t)4 * STATE_SIZE);
+    u8 *states = (u8*)malloc((size_t)POOL * STATE_SIZE);
+    u64 ids[POOL] = { 0 };
+    if (!bases || !states) {
+        fprintf(stderr, "test_page_store: out of memory\n");
+        exit(1);
+    }
+    for (int i = 0; i < 4; i++) random_state(bases + (size_t)i * STATE_SIZE, seed);
+
+    PageStore *store = page_store_create(STATE_SIZE, PAGE_SIZE, 0);
+    int bad = 0;
+    for (int op = 0; op < 5000; op++) {
+        u32 n = fuzz_rand(seed) % POOL;
+        u8 *state = states + (size_t)n * STATE_SIZE;
+        switch (fuzz_rand(seed) % 3) {
+            case 0:
+                if (ids[n]) page_store_evict(store, ids[n]);
+                memcpy(state, bases + (size_t)(fuzz_rand(seed) % 4) * STATE_SIZE, STATE_SIZE);
+                // Changes from a small set, so changed pages recur too
+                for (u32 k = fuzz_rand(seed) % 16; k > 0; k--) {
+                    state[(fuzz_rand(seed) % 64) * 613 % STATE_SIZE] ^= (u8)(1 + fuzz_rand(seed) % 3);
+                }
+                ids[n] = page_store_put(store, state);
+                break;
+            case 1:
+                if (ids[n] && !same_as(store, ids[n], state, out)) bad++;
+                break;
+            default:
+                if (ids[n] && !page_store_evict(store, ids[n])) bad++;
+                ids[n] = 0;
+                break;
+        }
+    }
+
+    const u8 *live[POOL];
+    u32 count = 0;
+    for (int n = 0; n < POOL; n++) {
+        if (!ids[n]) continue;
+        live[count++] = states + (size_t)n * STATE_SIZE;
+        if (!same_as(store, ids[n], live[count - 1], out)) bad++;
+    }
+    check(bad == 0, "random puts, gets and evicts read back");
+    check(page_store_states(store) == count, "live state count");
+    check(page_store_pages(store) == distinct_pages(live, count), "every distinct page stored once");
+    page_store_destroy(store);
+    free(bases);
+    free(states);
+}
+
+// A budget of about three unrelated states: the least recently used go
+static void test_budget(u32 *seed, u8 *a, u8 *out) {
+    u64 state_bytes = (u64)PAGES * PAGE_SIZE + PAGES * sizeof(u32);
+    PageStore *store = page_store_create(STATE_SIZE, PAGE_SIZE, 3 * state_bytes);
+    u64 ids[6];
+    for (int i = 0; i < 3; i++) {
+        random_state(a, seed);
+        ids[i] = page_store_put(store, a);
+    }
+    check(page_store_states(store) == 3, "three states fit the budget");
+
+    // Reading the oldest makes the second one the least recently used
+    check(page_store_get(store, ids[0], out), "get the oldest");
+    for (int i = 3; i < 6; i++) {
+        random_state(a, seed);
+        ids[i] = page_store_put(store, a);
+        check(page_store_bytes(store) <= 3 * state_bytes, "stays under the budget");
+    }
+    check(same_as(store, ids[5], a, out), "the newest state is kept");
+    check(!page_store_get(store, ids[1], out), "the least recently used state is evicted first");
+    page_store_destroy(store);
+}
+
+int main(int argc, char **argv) {
+    u32 seed = argc > 1 ? (u32)strtoul(argv[1], NULL, 0) : 0x50475354u;
+    u8 *a = (u8*)malloc(STATE_SIZE);
+    u8 *b = (u8*)malloc(STATE_SIZE);
+    u8 *out = (u8*)malloc(STATE_SIZE);
+    if (!a || !b || !out) {
+        fprintf(stderr, "test_page_store: out of memory\n");
+        return 1;
+    }
+    random_state(a, &seed);
+
+    test_sharing(a, b, out);
+    test_mix(&seed, out);
+    test_budget(&seed, a, out);
+
+    printf("test_page_store: %d failures\n", failures);
+    free(a);
+    free(b);
+    free(out);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+// Round trips through the rewind history
+//
+// Records a stream of states, rewinds by various distances and checks the
+// rebuilt state byte for byte against the copy kept when it was recorded:
+// within a keyframe interval, across keyframes, after recording again from
+// a rewound point, and after the ring has dropped its oldest frames. The
+// states come from rewind.h directly (random writes, like a frame touching
+// a few KB) and, when a ROM is given, from the game through emu_rewind.
+//
+// Usage: test_rewind [rom.gba]   (the game part is skipped without a ROM)
+
+#include "rewind.h"
+#include "python_api.h"
+#include "thumb_fuzz.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STATE_SIZE  0x10000
+#define FRAMES      200
+#define INTERVAL    8
+#define GAME_FRAMES 90
+
+static int failures;
+
+static void check(bool ok, const char *what, u32 frames) {
+    if (!ok) {
+        fprintf(stderr, "FAILED: %s (%u frames back)\n", what, frames);
+        failures++;
+    }
+}
+
+// Next state: a few hundred scattered bytes, sometimes a whole block
+static void next_state(u8 *state, u32 *seed) {
+    for (int i = 0; i < 200; i++) {
+        state[fuzz_rand(seed) % STATE_SIZE] = (u8)fuzz_rand(seed);
+    }
+    if (fuzz_rand(seed) % 16 == 0) {
+        u32 offset = fuzz_rand(seed) % (STATE_SIZE - 4096);
+        for (u32 i = 0; i < 4096; i++) state[offset + i] = (u8)fuzz_rand(seed);
+    }
+}
+
+// Record states[first..last] (one state per frame)
+static void record(RewindBuffer *rewind, u8 (*states)[STATE_SIZE], u32 first, u32 last) {
+    for (u32 f = first; f <= last; f++) rewind_push(rewind, states[f]);
+}
+
+// Seek back 'frames' from the newest state (index newest) and compare
+static void seek_and_compare(RewindBuffer *rewind, u8 (*states)[STATE_SIZE], u32 newest, u32 frames,
+                             u8 *out, const char *what) {
+    check(rewind_seek(rewind, frames, out), what, frames);
+    check(memcmp(out, states[newest - frames], STATE_SIZE) == 0, what, frames);
+}
+
+static void test_buffer(void) {
+    u8 (*states)[STATE_SIZE] = (u8 (*)[STATE_SIZE])calloc(FRAMES, STATE_SIZE);
+    u8 *out = (u8*)malloc(STATE_SIZE);
+    if (!states || !out) {
+        fprintf(stderr, "test_rewind: out of memory\n");
+        exit(1);
+    }
+    // states[0] is all zeros, so the first keyframe encodes to nothing
+    u32 seed = 0x52574E44u;
+    for (u32 f = 1; f < FRAMES; f++) {
+        memcpy(states[f], states[f - 1], STATE_SIZE);
+        next_state(states[f], &seed);
+    }
+
+    // Everything fits: all frames are reachable
+    RewindBuffer *rewind = rewind_create(STATE_SIZE, INTERVAL, 64 << 20);
+    record(rewind, states, 0, 99);
+    check(rewind_depth(rewind) == 99, "depth after 100 frames", 0);
+    seek_and_compare(rewind, states, 99, 3, out, "within a keyframe interval");
+    seek_and_compare(rewind, states, 96, 13, out, "across keyframes");
+    check(rewind_depth(rewind) == 83, "depth after seeking 16 back", 0);
+
+    // Recording continues from the rewound state (frame 83): the newer
+    // states are gone, and the recorded ones are still there
+    record(rewind, states, 84, 150);
+    seek_and_compare(rewind, states, 150, 30, out, "after recording past a rewind");
+    seek_and_compare(rewind, states, 120, 120, out, "back to the first state");
+    check(rewind_depth(rewind) == 0, "depth at the first state", 0);
+    check(!rewind_seek(rewind, 1, out), "seek past the oldest state fails", 1);
+    rewind_destroy(rewind);
+
+    // A ring for a few keyframes: the oldest groups are dropped, starting
+    // with the empty record of the all-zero first state, and the history
+    // starts at a keyframe
+    rewind = rewind_create(STATE_SIZE, INTERVAL, 40 * 200 * 16 + 2 * STATE_SIZE);
+    record(rewind, states, 0, FRAMES - 1);
+    u32 depth = rewind_depth(rewind);
+    check(depth > 0 && depth < FRAMES - 1, "ring trimmed", depth);
+    check((FRAMES - 1 - depth) % INTERVAL == 0, "oldest state is a keyframe", depth);
+    check(!rewind_seek(rewind, depth + 1, out), "seek past the trimmed history fails", depth + 1);
+    seek_and_compare(rewind, states, FRAMES - 1, 5, out, "after trimming");
+    for (u32 newest = FRAMES - 6; rewind_depth(rewind) > 0; newest--) {
+        seek_and_compare(rewind, states, newest, 1, out, "stepping back through the trimmed history");
+    }
+    check(memcmp(out, states[FRAMES - 1 - depth], STATE_SIZE) == 0, "oldest state after trimming", depth);
+    rewind_destroy(rewind);
+
+    free(states);
+    free(out);
+}
+
+// The same through the API: emu_snapshot after emu_rewind must equal the
+// snapshot taken when that frame was recorded. Snapshots are kept by frame
+// number, so a frame recorded again after a rewind replaces the old copy.
+typedef struct GameRun {
+    EmuHandle emu;
+    u32 size;
+    u8 *snapshots;        // GAME_FRAMES + 1 of them, by frame number
+    u8 *now;
+} GameRun;
+
+static u8 *game_snapshot(GameRun *run, u32 frame) {
+    return run->snapshots + (size_t)run->size * frame;
+}
+
+static void game_step(GameRun *run, u32 frames) {
+    for (u32 i = 0; i < frames; i++) {
+        u32 frame = emu_get_frame_count(run->emu);
+        emu_step(run->emu, (frame / 20) % 2 ? KEY_START : 0);
+        emu_snapshot(run->emu, game_snapshot(run, frame + 1));
+    }
+}
+
+static void game_rewind(GameRun *run, u32 frames, const char *what) {
+    u32 frame = emu_get_frame_count(run->emu);
+    check(emu_rewind(run->emu, frames) == frames, what, frames);
+    emu_snapshot(run->emu, run->now);
+    check(memcmp(run->now, game_snapshot(run, frame - frames), run->size) == 0, what, frames);
+}
+
+static void test_game(const char *rom_path) {
+    GameRun run;
+    run.emu = emu_init(rom_path);
+    if (!run.emu) {
+        printf("test_rewind: no ROM at '%s', game part skipped\n", rom_path);
+        return;
+    }
+    run.size = emu_snapshot_size();
+    run.snapshots = (u8*)malloc((size_t)run.size * (GAME_FRAMES + 1));
+    run.now = (u8*)malloc(run.size);
+    if (!run.snapshots || !run.now) {
+        fprintf(stderr, "test_rewind: out of memory\n");
+        exit(1);
+    }
+
+    // Room for every frame
+    emu_rewind_enable(run.emu, INTERVAL, 64 << 20);
+    emu_snapshot(run.emu, game_snapshot(&run, 0));
+    game_step(&run, 40);
+    game_rewind(&run, 3, "emu_rewind within a keyframe interval");
+    game_rewind(&run, 13, "emu_rewind across keyframes");
+    game_step(&run, 20);
+    game_rewind(&run, 30, "emu_rewind after recording past a rewind");
+
+    // A ring for a few frames: the oldest are dropped as the game runs on
+    emu_rewind_enable(run.emu, INTERVAL, run.size);
+    game_step(&run, GAME_FRAMES - emu_get_frame_count(run.emu));
+    u32 depth = emu_rewind_depth(run.emu);
+    check(depth > INTERVAL && depth < 40, "game history trimmed", depth);
+    game_rewind(&run, INTERVAL + 1, "emu_rewind after trimming");
+    game_rewind(&run, emu_rewind_depth(run.emu), "emu_rewind to the oldest frame after trimming");
+
+    free(run.snapshots);
+    free(run.now);
+    emu_cleanup(run.emu);
+}
+
+int main(int argc, char **argv) {
+    test_buffer();
+    if (argc > 1) test_game(argv[1]);
+    printf("test_rewind: %d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+#ifndef THUMB_FUZZ_H
+#define THUMB_FUZZ_H
+
+#include "types.h"
+#include "cpu_core.h"
+#include "thumb_block.h"
+#include <string.h>
+
+// Random Thumb code and CPU states for the differential tests (test_jit,
+// test_aot). Everything is driven by one xorshift32 state, so a failing
+// trial can be replayed from its seed.
+
+#define FUZZ_ROM_SIZE 0x10000   // 64KB of code at 0x08000000
+
+static inline u32 fuzz_rand(u32 *state) {
+    u32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// A random Thumb instruction, weighted towards the formats the translators
+// emit inline (shifts, add/sub, immediates, ALU and hi-register ops) and
+// short branches. SWI, undefined encodings, BL halves and register writes
+// to PC are left out: they would leave the ROM or the Thumb state.
+static inline u16 fuzz_thumb_op(u32 *state) {
+    for (;;) {
+        u16 op = (u16)fuzz_rand(state);
+        u32 kind = fuzz_rand(state) % 10;
+        if (kind < 3) {
+            op &= 0x3FFF;                                    // Formats 1-3
+        } else if (kind < 5) {
+            op = 0x4000 | (op & 0x3FF);                      // ALU, hi-register
+        } else if (kind < 6) {
+            op = 0xD000 | (op & 0xDFF);                      // Conditional branch
+        } else if (kind < 7) {
+            op = 0xE000 | ((fuzz_rand(state) % 128 - 64) & 0x7FF);  // B
+        }
+
+        if ((op >> 8) == 0xDE || (op >> 8) == 0xDF) continue;  // Undefined, SWI
+        if ((op >> 11) >= 0x1D) continue;                     // BLX, BL halves
+        if ((op & 0xFF00) == 0xBD00) continue;                // POP {..., PC}
+        if ((op & 0xFC00) == 0x4400 && thumb_ends_block(op)) continue;  // BX, PC writes
+        return op;
+    }
+}
+
+// Fill a FUZZ_ROM_SIZE ROM with random code. About one instruction in 64 is
+// a BL pair calling somewhere nearby, so call/return blocks get covered.
+static inline void fuzz_fill_rom(u8 *rom, u32 *state) {
+    for (u32 offset = 0; offset < FUZZ_ROM_SIZE; offset += 2) {
+        u16 op = fuzz_thumb_op(state);
+        if (offset + 4 <= FUZZ_ROM_SIZE && fuzz_rand(state) % 64 == 0) {
+            s32 target = (s32)(fuzz_rand(state) % 4096) - 2048;  // Halfwords from PC
+            u32 bits = (u32)target & 0x3FFFFF;
+            u16 hi = (u16)(0xF000 | (bits >> 11));
+            u16 lo = (u16)(0xF800 | (bits & 0x7FF));
+            rom[offset] = (u8)hi;
+            rom[offset + 1] = (u8)(hi >> 8);
+            rom[offset + 2] = (u8)lo;
+            rom[offset + 3] = (u8)(lo >> 8);
+            offset += 2;
+            continue;
+        }
+        rom[offset] = (u8)op;
+        rom[offset + 1] = (u8)(op >> 8);
+    }
+}
+
+// Thumb state at pc with registers that are either small values or
+// word-aligned pointers into IWRAM/EWRAM, so loads and stores hit RAM
+static inline void fuzz_cpu_state(ARM7TDMI *cpu, u32 *state, u32 pc) {
+    memset(cpu, 0, sizeof(*cpu));
+    for (int r = 0; r < 13; r++) {
+        if (fuzz_rand(state) & 1) {
+            cpu->r[r] = fuzz_rand(state) % 64;
+        } else {
+            u32 base = (fuzz_rand(state) & 1) ? 0x03001000 : 0x02010000;
+            cpu->r[r] = base + (fuzz_rand(state) & 0xFFC);
+        }
+    }
+    cpu->r[13] = 0x03007F00;
+    cpu->r[14] = 0x08000001;
+    cpu->r[15] = pc + 4;
+    cpu->cpsr = (fuzz_rand(state) & 0xF0000000) | 0x3F;  // System mode, Thumb
+    cpu->flag_op = FLAGS_NONE;
+    cpu->thumb_mode = true;
+}
+
+#endif // THUMB_FUZZ_H
@@ -0,0 +1,289 @@
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE  // sysconf(_SC_NPROCESSORS_ONLN)
+#endif
+
+#include "thread_pool.h"
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+typedef SRWLOCK PoolMutex;
+typedef CONDITION_VARIABLE PoolCond;
+typedef HANDLE PoolThread;
+#else
+#include <pthread.h>
+#include <unistd.h>
+typedef pthread_mutex_t PoolMutex;
+typedef pthread_cond_t PoolCond;
+typedef pthread_t PoolThread;
+#endif
+
+// Range of indices still owned by one participant. Padded so neighbouring
+// queues don't share a cache line.
+typedef struct WorkQueue {
+    PoolMutex lock;
+    u32 next;             // Next index to run
+    u32 end;              // One past the last index
+    u8 pad[64];
+} WorkQueue;
+
+typedef struct PoolWorker {
+    ThreadPool *pool;
+    u32 id;
+} PoolWorker;
+
+struct ThreadPool {
+    u32 size;             // Participants, [0] is the thread calling thread_pool_run
+    PoolThread *threads;  // size - 1 worker threads
+    PoolWorker *workers;
+    WorkQueue *queues;    // One per participant
+    
+    PoolMutex lock;       // Guards everything below
+    PoolCond start;       // Signalled when a new job is posted
+    PoolCond done;        // Signalled when the last worker finishes
+    u64 generation;       // Bumped for every job
+    u32 running;          // Worker threads still busy with the current job
+    bool quit;
+    ThreadPoolTask task;
+    void *context;
+};
+
+// Host primitives
+
+#ifdef _WIN32
+static void mutex_init(PoolMutex *m) { InitializeSRWLock(m); }
+static void mutex_destroy(PoolMutex *m) { (void)m; }
+static void mutex_lock(PoolMutex *m) { AcquireSRWLockExclusive(m); }
+static void mutex_unlock(PoolMutex *m) { ReleaseSRWLockExclusive(m); }
+static void cond_init(PoolCond *c) { InitializeConditionVariable(c); }
+static void cond_destroy(PoolCond *c) { (void)c; }
+static void cond_wait(PoolCond *c, PoolMutex *m) { SleepConditionVariableSRW(c, m, INFINITE, 0); }
+static void cond_signal(PoolCond *c) { WakeConditionVariable(c); }
+static void cond_broadcast(PoolCond *c) { WakeAllConditionVariable(c); }
+#else
+static void mutex_init(PoolMutex *m) { pthread_mutex_init(m, NULL); }
+static void mutex_destroy(PoolMutex *m) { pthread_mutex_destroy(m); }
+static void mutex_lock(PoolMutex *m) { pthread_mutex_lock(m); }
+static void mutex_unlock(PoolMutex *m) { pthread_mutex_unlock(m); }
+static void cond_init(PoolCond *c) { pthread_cond_init(c, NULL); }
+static void cond_destroy(PoolCond *c) { pthread_cond_destroy(c); }
+static void cond_wait(PoolCond *c, PoolMutex *m) { pthread_cond_wait(c, m); }
+static void cond_signal(PoolCond *c) { pthread_cond_signal(c); }
+static void cond_broadcast(PoolCond *c) { pthread_cond_broadcast(c); }
+#endif
+
+u32 thread_pool_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? (u32)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (u32)n : 1;
+#endif
+}
+
+// Scheduling
+
+// Take the next index from our own range
+static bool pool_take(WorkQueue *queue, u32 *index) {
+    bool found = false;
+    mutex_lock(&queue->lock);
+    if (queue->next < queue->end) {
+        *index = queue->next++;
+        found = true;
+    }
+    mutex_unlock(&queue->lock);
+    return found;
+}
+
+// Move the upper half of the fullest other range into our (empty) queue
+static bool pool_steal(ThreadPool *pool, u32 self) {
+    for (;;) {
+        u32 victim = self;
+        u32 best = 0;
+        for (u32 i = 0; i < pool->size; i++) {
+            if (i == self) continue;
+            WorkQueue *q = &pool->queues[i];
+            mutex_lock(&q->lock);
+            u32 left = q->end - q->next;
+            mutex_unlock(&q->lock);
+            if (left > best) {
+                best = left;
+                victim = i;
+            }
+        }
+        if (victim == self) return false;  // Nothing left anywhere
+        
+        WorkQueue *q = &pool->queues[victim];
+        u32 first = 0, last = 0;
+        mutex_lock(&q->lock);
+        u32 left = q->end - q->next;
+        if (left > 0) {
+            u32 take = (left + 1) / 2;
+            last = q->end;
+            first = last - take;
+            q->end = first;
+        }
+        mutex_unlock(&q->lock);
+        if (first == last) continue;  // Drained meanwhile, look again
+        
+        WorkQueue *own = &pool->queues[self];
+        mutex_lock(&own->lock);
+        own->next = first;
+        own->end = last;
+        mutex_unlock(&own->lock);
+        return true;
+    }
+}
+
+static void pool_work(ThreadPool *pool, u32 self) {
+    WorkQueue *own = &pool->queues[self];
+    u32 index;
+    for (;;) {
+        while (pool_take(own, &index)) {
+            pool->task(pool->context, index);
+        }
+        if (!pool_steal(pool, self)) break;
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI pool_thread_main(LPVOID arg)
+#else
+static void *pool_thread_main(void *arg)
+#endif
+{
+    PoolWorker *worker = (PoolWorker*)arg;
+    ThreadPool *pool = worker->pool;
+    u64 seen = 0;
+    
+    mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->quit && pool->generation == seen) {
+            cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->quit) break;
+        seen = pool->generation;
+        mutex_unlock(&pool->lock);
+        
+        pool_work(pool, worker->id);
+        
+        mutex_lock(&pool->lock);
+        if (--pool->running == 0) {
+            cond_signal(&pool->done);
+        }
+    }
+    mutex_unlock(&pool->lock);
+    return 0;
+}
+
+// Pool lifetime
+
+ThreadPool *thread_pool_create(u32 threads) {
+    if (threads == 0) threads = thread_pool_cpu_count();
+    
+    ThreadPool *pool = (ThreadPool*)calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+    pool->queues = (WorkQueue*)calloc(threads, sizeof(WorkQueue));
+    pool->workers = (PoolWorker*)calloc(threads, sizeof(PoolWorker));
+    pool->threads = (PoolThread*)calloc(threads, sizeof(PoolThread));
+    if (!pool->queues || !pool->workers || !pool->threads) {
+        free(pool->queues);
+        free(pool->workers);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    
+    mutex_init(&pool->lock);
+    cond_init(&pool->start);
+    cond_init(&pool->done);
+    for (u32 i = 0; i < threads; i++) {
+        mutex_init(&pool->queues[i].lock);
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i;
+    }
+    
+    // Participant 0 is the caller; start the others
+    pool->size = 1;
+    for (u32 i = 1; i < threads; i++) {
+#ifdef _WIN32
+        pool->threads[i - 1] = CreateThread(NULL, 0, pool_thread_main, &pool->workers[i], 0, NULL);
+        if (!pool->threads[i - 1]) break;
+#else
+        if (pthread_create(&pool->threads[i - 1], NULL, pool_thread_main, &pool->workers[i]) != 0) break;
+#endif
+        pool->size++;
+    }
+    
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+    if (!pool) return;
+    
+    mutex_lock(&pool->lock);
+    pool->quit = true;
+    cond_broadcast(&pool->start);
+    mutex_unlock(&pool->lock);
+    
+    for (u32 i = 0; i + 1 < pool->size; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(pool->threads[i], INFINITE);
+        CloseHandle(pool->threads[i]);
+#else
+        pthread_join(pool->threads[i], NULL);
+#endif
+    }
+    
+    for (u32 i = 0; i < pool->size; i++) {
+        mutex_destroy(&pool->queues[i].lock);
+    }
+    cond_destroy(&pool->done);
+    cond_destroy(&pool->start);
+    mutex_destroy(&pool->lock);
+    free(pool->queues);
+    free(pool->workers);
+    free(pool->threads);
+    free(pool);
+}
+
+u32 thread_pool_size(const ThreadPool *pool) {
+    return pool ? pool->size : 1;
+}
+
+void thread_pool_run(ThreadPool *pool, ThreadPoolTask task, void *context, u32 count) {
+    if (count == 0) return;
+    
+    // Nothing to share: run inline
+    if (!pool || pool->size == 1 || count == 1) {
+        for (u32 i = 0; i < count; i++) {
+            task(context, i);
+        }
+        return;
+    }
+    
+    mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->context = context;
+    for (u32 i = 0; i < pool->size; i++) {
+        WorkQueue *q = &pool->queues[i];
+        mutex_lock(&q->lock);
+        q->next = (u32)((u64)count * i / pool->size);
+        q->end = (u32)((u64)count * (i + 1) / pool->size);
+        mutex_unlock(&q->lock);
+    }
+    pool->running = pool->size - 1;
+    pool->generation++;
+    cond_broadcast(&pool->start);
+    mutex_unlock(&pool->lock);
+    
+    pool_work(pool, 0);
+    
+    mutex_lock(&pool->lock);
+    while (pool->running > 0) {
+        cond_wait(&pool->done, &pool->lock);
+    }
+    mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,32 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "types.h"
+
+// Work-stealing thread pool for data-parallel loops
+//
+// thread_pool_run() spreads indices [0, count) over the workers in equal
+// contiguous ranges. A worker takes indices from the front of its own range;
+// once that is empty it steals the upper half of the fullest remaining range.
+// The calling thread works as participant 0, and the call returns only after
+// every index has been processed. One job runs at a time per pool.
+
+typedef struct ThreadPool ThreadPool;
+
+typedef void (*ThreadPoolTask)(void *context, u32 index);
+
+// Create a pool with 'threads' participants including the caller
+// (0 = one per online CPU). Returns NULL on failure.
+ThreadPool *thread_pool_create(u32 threads);
+void thread_pool_destroy(ThreadPool *pool);
+
+// Participants (worker threads + the calling thread)
+u32 thread_pool_size(const ThreadPool *pool);
+
+// Call task(context, i) for every i in [0, count) and wait for all of them
+void thread_pool_run(ThreadPool *pool, ThreadPoolTask task, void *context, u32 count);
+
+// Online CPUs on this host (at least 1)
+u32 thread_pool_cpu_count(void);
+
+#endif // THREAD_POOL_H
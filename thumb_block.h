@@ -0,0 +1,22 @@
+#ifndef THUMB_BLOCK_H
+#define THUMB_BLOCK_H
+
+#include "types.h"
+
+// Where Thumb blocks end. Shared by the interpreter's block decoder
+// (cpu_core.c) and the ahead-of-time translator (aot_gen.c), whose blocks
+// must start and stop at the same instructions.
+
+// True if a Thumb instruction can change PC or CPU state and must end a block
+static inline bool thumb_ends_block(u16 op) {
+    if ((op & 0xFC00) == 0x4400) {
+        // Hi register ADD/MOV with PC as destination, and BX
+        return ((op >> 8) & 0x3) == 0x3 || (((op >> 8) & 0x3) != 0x1 && (op & 0x87) == 0x87);
+    }
+    if ((op & 0xFF00) == 0xBD00) return true;  // POP {..., PC}
+    if ((op >> 12) == 0xD) return true;        // Conditional branch, SWI
+    if ((op >> 11) >= 0x1C) return true;       // B, BL
+    return false;
+}
+
+#endif // THUMB_BLOCK_H
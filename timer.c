@@ -1,105 +1,134 @@
-#include "timer.h"
-#include "interrupts.h"
-#include <string.h>
-
-void timer_init(TimerState *state) {
-    memset(state, 0, sizeof(TimerState));
-    
-    for (int i = 0; i < 4; i++) {
-        state->timers[i].prescaler = 1;
-    }
-}
-
-static u32 get_prescaler(u16 control) {
-    switch (control & TIMER_FREQ_MASK) {
-        case 0: return 1;
-        case 1: return 64;
-        case 2: return 256;
-        case 3: return 1024;
-    }
-    return 1;
-}
-
-void timer_update(TimerState *state, u32 cycles, InterruptState *interrupts) {
-    for (int i = 0; i < 4; i++) {
-        Timer *timer = &state->timers[i];
-        
-        if (!timer->enabled) continue;
-        
-        // Cascade mode: increment when previous timer overflows
-        if (timer->cascade && i > 0) {
-            continue; // Handled when previous timer overflows
-        }
-        
-        // Add cycles to internal clock
-        timer->clock += cycles;
-        
-        // Check if prescaler threshold reached
-        while (timer->clock >= timer->prescaler) {
-            timer->clock -= timer->prescaler;
-            timer->counter++;
-            
-            // Check for overflow
-            if (timer->counter == 0) {
-                // Reload
-                timer->counter = timer->reload;
-                
-                // Trigger IRQ if enabled
-                if (timer->irq_enable && interrupts) {
-                    interrupt_raise(interrupts, INT_TIMER0 << i);
-                }
-                
-                // Increment cascade timer if enabled
-                if (i < 3 && state->timers[i + 1].cascade && state->timers[i + 1].enabled) {
-                    state->timers[i + 1].counter++;
-                    if (state->timers[i + 1].counter == 0) {
-                        state->timers[i + 1].counter = state->timers[i + 1].reload;
-                        if (state->timers[i + 1].irq_enable && interrupts) {
-                            interrupt_raise(interrupts, INT_TIMER0 << (i + 1));
-                        }
-                    }
-                }
-            }
-        }
-    }
-}
-
-void timer_write_control(TimerState *state, int timer_id, u16 value) {
-    if (timer_id < 0 || timer_id >= 4) return;
-    
-    Timer *timer = &state->timers[timer_id];
-    
-    bool was_enabled = timer->enabled;
-    timer->control = value;
-    timer->enabled = (value & TIMER_ENABLE) != 0;
-    timer->irq_enable = (value & TIMER_IRQ) != 0;
-    timer->cascade = (value & TIMER_CASCADE) != 0;
-    timer->prescaler = get_prescaler(value);
-    
-    // If timer just got enabled, reload counter
-    if (timer->enabled && !was_enabled) {
-        timer->counter = timer->reload;
-        timer->clock = 0;
-    }
-}
-
-void timer_write_reload(TimerState *state, int timer_id, u16 value) {
-    if (timer_id < 0 || timer_id >= 4) return;
-    
-    state->timers[timer_id].reload = value;
-    
-    // If timer is disabled, also update counter
-    if (!state->timers[timer_id].enabled) {
-        state->timers[timer_id].counter = value;
-    }
-}
-
-u16 timer_read_counter(TimerState *state, int timer_id) {
-    if (timer_id < 0 || timer_id >= 4) return 0;
-    return state->timers[timer_id].counter;
-}
-
-u16 timer_read_control(TimerState *state, int timer_id) {
-    if (timer_id < 0 || timer_id >= 4) return 0;
-    return state->timers[timer_id].control;
-}
+#include "timer.h"
+#include "interrupts.h"
+#include <string.h>
+
+void timer_init(TimerState *state) {
+    memset(state, 0, sizeof(TimerState));
+    
+    for (int i = 0; i < 4; i++) {
+        state->timers[i].prescaler = 1;
+    }
+}
+
+static u32 get_prescaler(u16 control) {
+    switch (control & TIMER_FREQ_MASK) {
+        case 0: return 1;
+        case 1: return 64;
+        case 2: return 256;
+        case 3: return 1024;
+    }
+    return 1;
+}
+
+// Count 'ticks' increments on a timer, returns how many times it overflowed
+static u32 timer_advance(Timer *timer, u32 ticks) {
+    u32 to_overflow = 0x10000 - timer->counter;
+    if (ticks < to_overflow) {
+        timer->counter += ticks;
+        return 0;
+    }
+    
+    // Overflow, then keep counting up from the reload value
+    ticks -= to_overflow;
+    u32 period = 0x10000 - timer->reload;
+    timer->counter = (u16)(timer->reload + ticks % period);
+    return 1 + ticks / period;
+}
+
+void timer_update(TimerState *state, u32 cycles, InterruptState *interrupts) {
+    u32 overflows = 0; // Overflows of the previous timer, for cascade mode
+    
+    for (int i = 0; i < 4; i++) {
+        Timer *timer = &state->timers[i];
+        
+        if (!timer->enabled) {
+            overflows = 0;
+            continue;
+        }
+        
+        u32 ticks;
+        if (timer->cascade && i > 0) {
+            // Cascade mode: increment when previous timer overflows
+            ticks = overflows;
+        } else {
+            // Add cycles to internal clock
+            timer->clock += cycles;
+            ticks = timer->clock / timer->prescaler;
+            timer->clock %= timer->prescaler;
+        }
+        
+        overflows = timer_advance(timer, ticks);
+        
+        // Trigger IRQ if enabled
+        if (overflows && timer->irq_enable && interrupts) {
+            interrupt_raise(interrupts, INT_TIMER0 << i);
+        }
+    }
+}
+
+void timer_sync(TimerState *state, u64 now, InterruptState *interrupts) {
+    while (now > state->last_sync) {
+        u64 delta = now - state->last_sync;
+        u32 cycles = (delta > 0x40000000) ? 0x40000000 : (u32)delta;
+        timer_update(state, cycles, interrupts);
+        state->last_sync += cycles;
+    }
+}
+
+// Cycle stamp of the n-th next overflow of a timer (n >= 1)
+static u64 timer_overflow_at(const TimerState *state, int timer_id, u64 n) {
+    const Timer *timer = &state->timers[timer_id];
+    if (!timer->enabled) return UINT64_MAX;
+    
+    u64 ticks = (0x10000 - timer->counter) + (n - 1) * (0x10000 - timer->reload);
+    if (timer->cascade && timer_id > 0) {
+        return timer_overflow_at(state, timer_id - 1, ticks);
+    }
+    return state->last_sync + ticks * timer->prescaler - timer->clock;
+}
+
+u64 timer_next_irq(const TimerState *state, int timer_id) {
+    if (timer_id < 0 || timer_id >= 4) return UINT64_MAX;
+    if (!state->timers[timer_id].irq_enable) return UINT64_MAX;
+    return timer_overflow_at(state, timer_id, 1);
+}
+
+void timer_write_control(TimerState *state, int timer_id, u16 value) {
+    if (timer_id < 0 || timer_id >= 4) return;
+    
+    Timer *timer = &state->timers[timer_id];
+    
+    bool was_enabled = timer->enabled;
+    timer->control = value;
+    timer->enabled = (value & TIMER_ENABLE) != 0;
+    timer->irq_enable = (value & TIMER_IRQ) != 0;
+    timer->cascade = (value & TIMER_CASCADE) != 0;
+    timer->prescaler = get_prescaler(value);
+    
+    // If timer just got enabled, reload counter
+    if (timer->enabled && !was_enabled) {
+        timer->counter = timer->reload;
+        timer->clock = 0;
+    }
+}
+
+void timer_write_reload(TimerState *state, int timer_id, u16 value) {
+    if (timer_id < 0 || timer_id >= 4) return;
+    
+    state->timers[timer_id].reload = value;
+    
+    // If timer is disabled, also update counter
+    if (!state->timers[timer_id].enabled) {
+        state->timers[timer_id].counter = value;
+    }
+}
+
+u16 timer_read_counter(TimerState *state, int timer_id) {
+    if (timer_id < 0 || timer_id >= 4) return 0;
+    return state->timers[timer_id].counter;
+}
+
+u16 timer_read_control(TimerState *state, int timer_id) {
+    if (timer_id < 0 || timer_id >= 4) return 0;
+    return state->timers[timer_id].control;
+}